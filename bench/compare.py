@@ -0,0 +1,268 @@
+"""
+script to compare the microbenchmarks or the end-to-end scenarios against a stored baseline
+
+The benchmarks are run --repetitions times, interleaved so that a slow period of the
+machine does not only hit one of them. The time per iteration of each benchmark is
+summarized by its median, with a confidence interval computed from order statistics,
+which needs no assumption on the distribution of the times. With fewer than 6 repetitions,
+even the range of the times covers the median with less than 95% confidence, so a warning
+is printed when the intervals are below --confidence.
+
+With --scenarios, the JSON outputs of run_scenarios.py are compared instead of running the
+microbenchmarks, each file being a repetition and each point a benchmark timed by its ns per share.
+
+A benchmark is flagged as a regression when its median is more than --threshold percent
+above the one of the baseline and the confidence intervals do not overlap, and as an
+improvement in the opposite case. The script exits with 1 if any regression is flagged.
+
+Runs are stored as <name>.json in --baselines-dir:
+- with --baseline NAME, the run is compared to NAME, which is created from the run if it does not exist
+- with --save NAME, the run is also stored as NAME, e.g. to update a baseline
+- with --current NAME, the stored run NAME is compared instead of running the benchmarks
+
+usage: python compare.py --bench build/poolsim_bench --baseline upstream --filter RewardScheme
+       python compare.py --scenarios run1.json run2.json run3.json --baseline upstream
+"""
+
+import argparse
+import datetime
+import json
+import math
+import os
+import subprocess
+import sys
+
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def run_benchmarks(benches, repetitions, bench_filter, min_time):
+    """returns the times per iteration of each repetition, by benchmark name"""
+    times = {}
+    for bench in benches:
+        command = [
+            bench,
+            "--benchmark_filter=" + bench_filter,
+            "--benchmark_repetitions=" + str(repetitions),
+            "--benchmark_enable_random_interleaving=true",
+            "--benchmark_format=json",
+        ]
+        if min_time is not None:
+            command.append("--benchmark_min_time=" + str(min_time))
+        print(" ".join(command), file=sys.stderr)
+        output = subprocess.run(command, check=True, stdout=subprocess.PIPE).stdout
+        for result in json.loads(output)["benchmarks"]:
+            if result["run_type"] != "iteration" or "error_occurred" in result:
+                continue
+            times.setdefault(result["run_name"], {"real_time": [], "cpu_time": []})
+            for metric in ("real_time", "cpu_time"):
+                times[result["run_name"]][metric].append(to_nanoseconds(result[metric], result["time_unit"]))
+    return times
+
+
+def read_scenarios(filepaths):
+    """returns the ns per share of each repetition, by scenario point"""
+    times = {}
+    for filepath in filepaths:
+        with open(filepath) as f:
+            points = json.load(f)
+        for point in points:
+            if point["status"] != "ok" or point.get("ns_per_share") is None:
+                continue
+            name = "{config} {axis} miners={miners} pools={pools} blocks={blocks}".format(**point)
+            times.setdefault(name, {"ns_per_share": []})["ns_per_share"].append(point["ns_per_share"])
+    return times
+
+
+def to_nanoseconds(value, unit):
+    return value * {"ns": 1, "us": 1e3, "ms": 1e6, "s": 1e9}[unit]
+
+
+def median(values):
+    values = sorted(values)
+    middle = len(values) // 2
+    if len(values) % 2:
+        return values[middle]
+    return (values[middle - 1] + values[middle]) / 2
+
+
+def median_interval(values, confidence):
+    """returns a confidence interval of the median and the probability that it covers the median
+
+    The median is outside of the k + 1-th smallest and k + 1-th largest values when at
+    most k values are below or above it, which has a binomial probability. k is the largest
+    keeping the probability of either side under (1 - confidence) / 2. When there are too few
+    values for any k, the interval is the range of the values and covers the median with
+    less than the requested confidence.
+    """
+    values = sorted(values)
+    n = len(values)
+    alpha = (1 - confidence) / 2
+    excluded, cumulative = 0, 0.0
+    for k in range((n - 1) // 2):
+        cumulative += math.comb(n, k) / 2 ** n
+        if cumulative > alpha:
+            break
+        excluded = k
+    outside = sum(math.comb(n, k) for k in range(excluded + 1)) / 2 ** n
+    return values[excluded], values[n - 1 - excluded], 1 - 2 * outside
+
+
+def summarize(times, metric, confidence):
+    summary = {}
+    for name, metrics in times.items():
+        values = metrics[metric]
+        if not values:
+            continue
+        low, high, coverage = median_interval(values, confidence)
+        summary[name] = dict(median=median(values), low=low, high=high, coverage=coverage,
+                             repetitions=len(values))
+    return summary
+
+
+def min_repetitions(confidence):
+    """returns the repetitions needed for the range of the values to reach the confidence"""
+    return math.ceil(math.log2(2 / (1 - confidence)))
+
+
+def warn_coverage(name, summary, confidence):
+    low = [stats for stats in summary.values() if stats["coverage"] < confidence]
+    if low:
+        print("warning: intervals of {} cover the median with only {:.1%} confidence, below {:.0%};"
+              " {} repetitions are needed".format(name, min(stats["coverage"] for stats in low), confidence,
+                                                  min_repetitions(confidence)), file=sys.stderr)
+
+
+def compare(baseline, current, threshold):
+    """returns the rows of the comparison, in the order of the current run"""
+    rows = []
+    for name, stats in current.items():
+        base = baseline.get(name)
+        row = dict(name=name, current=stats, baseline=base, change=None, status="new")
+        if base is not None:
+            row["change"] = (stats["median"] - base["median"]) / base["median"] * 100
+            if row["change"] > threshold and stats["low"] > base["high"]:
+                row["status"] = "REGRESSION"
+            elif row["change"] < -threshold and stats["high"] < base["low"]:
+                row["status"] = "improvement"
+            else:
+                row["status"] = "~"
+        rows.append(row)
+    return rows
+
+
+def format_time(nanoseconds):
+    for unit, scale in (("s", 1e9), ("ms", 1e6), ("us", 1e3)):
+        if nanoseconds >= scale:
+            return "{:.3g} {}".format(nanoseconds / scale, unit)
+    return "{:.3g} ns".format(nanoseconds)
+
+
+def format_stats(stats):
+    if stats is None:
+        return "-"
+    return "{} [{}, {}]".format(format_time(stats["median"]), format_time(stats["low"]), format_time(stats["high"]))
+
+
+def print_rows(rows, baseline_name, current_name, file=sys.stdout):
+    header = ("benchmark", baseline_name, current_name, "change", "")
+    lines = [header]
+    for row in rows:
+        change = "-" if row["change"] is None else "{:+.1f}%".format(row["change"])
+        lines.append((row["name"], format_stats(row["baseline"]), format_stats(row["current"]), change, row["status"]))
+    widths = [max(len(line[i]) for line in lines) for i in range(len(header))]
+    for line in lines:
+        print("  ".join(value.ljust(width) for value, width in zip(line, widths)).rstrip(), file=file)
+
+
+def get_baseline_path(directory, name):
+    return os.path.join(directory, name + ".json")
+
+
+def load_run(directory, name):
+    with open(get_baseline_path(directory, name)) as f:
+        return json.load(f)
+
+
+def save_run(directory, name, run):
+    os.makedirs(directory, exist_ok=True)
+    with open(get_baseline_path(directory, name), "w") as f:
+        json.dump(run, f, indent=2)
+    print("saved run as baseline {}".format(name), file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(prog="bench-compare")
+    parser.add_argument("--bench", action="append", default=[],
+                        help="benchmark executable, can be repeated, build/poolsim_bench by default")
+    parser.add_argument("--baseline", required=True, help="name of the baseline to compare with")
+    parser.add_argument("--save", help="also store the run under this name")
+    parser.add_argument("--current", help="compare this stored run instead of running the benchmarks")
+    parser.add_argument("--scenarios", nargs="+",
+                        help="compare these JSON outputs of run_scenarios.py, one per repetition, "
+                             "instead of running the benchmarks")
+    parser.add_argument("--baselines-dir", default=os.path.join(ROOT, "bench", "build", "baselines"),
+                        help="directory of the stored runs")
+    parser.add_argument("--filter", default=".", help="regular expression selecting the benchmarks to run")
+    parser.add_argument("--repetitions", type=int, default=10, help="runs of each benchmark")
+    parser.add_argument("--min-time", type=float, help="minimum seconds of each run of a benchmark")
+    parser.add_argument("--metric", choices=["cpu_time", "real_time"], default="cpu_time",
+                        help="time per iteration compared")
+    parser.add_argument("--confidence", type=float, default=0.95, help="confidence level of the intervals")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="percentage of slowdown above which a benchmark can be flagged")
+    args = parser.parse_args()
+
+    if args.current is not None:
+        run = load_run(args.baselines_dir, args.current)
+        current_name = args.current
+    elif args.scenarios is not None:
+        run = dict(
+            date=datetime.datetime.now().isoformat(timespec="seconds"),
+            repetitions=len(args.scenarios),
+            kind="scenarios",
+            times=read_scenarios(args.scenarios),
+        )
+        current_name = "current"
+        if args.save is not None:
+            save_run(args.baselines_dir, args.save, run)
+    else:
+        benches = args.bench or [os.path.join(ROOT, "bench", "build", "poolsim_bench")]
+        run = dict(
+            date=datetime.datetime.now().isoformat(timespec="seconds"),
+            repetitions=args.repetitions,
+            times=run_benchmarks(benches, args.repetitions, args.filter, args.min_time),
+        )
+        current_name = "current"
+        if args.save is not None:
+            save_run(args.baselines_dir, args.save, run)
+
+    if not os.path.exists(get_baseline_path(args.baselines_dir, args.baseline)):
+        print("no baseline {}, nothing to compare".format(args.baseline), file=sys.stderr)
+        if args.current is None and args.save != args.baseline:
+            save_run(args.baselines_dir, args.baseline, run)
+        return 0
+
+    baseline_run = load_run(args.baselines_dir, args.baseline)
+    if baseline_run.get("kind") != run.get("kind"):
+        print("baseline {} and the current run are not of the same kind".format(args.baseline), file=sys.stderr)
+        return 2
+    # scenarios are only timed per share
+    metric = "ns_per_share" if run.get("kind") == "scenarios" else args.metric
+    baseline = summarize(baseline_run["times"], metric, args.confidence)
+    current = summarize(run["times"], metric, args.confidence)
+    warn_coverage(args.baseline, baseline, args.confidence)
+    warn_coverage(current_name, current, args.confidence)
+    rows = compare(baseline, current, args.threshold)
+    print_rows(rows, args.baseline, current_name)
+
+    regressions = [row["name"] for row in rows if row["status"] == "REGRESSION"]
+    if regressions:
+        print("{} regression(s) above {}%: {}".format(len(regressions), args.threshold, ", ".join(regressions)),
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,298 @@
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+
+#include "allocation_tracker.h"
+#include "perf_counters.h"
+#include "event_queue.h"
+#include "json_writer.h"
+#include "mining_pool.h"
+#include "miner.h"
+#include "network.h"
+#include "random.h"
+#include "reward_scheme.h"
+#include "share_handler.h"
+#include "simulation.h"
+#include "simulator.h"
+
+using namespace poolsim;
+
+// Microbenchmarks of the components on the hot path of a simulation
+// Run with `make bench`, which writes the results as JSON to bench/build/bench.json
+
+static const long bench_seed = 1;
+
+// Counts the allocations and hardware events of the timed loop, which is what follows
+// its construction, operator new being replaced by instrumented/allocation_hook.cpp
+// Reported per iteration, the hardware events only when the kernel allows counting them.
+// Fails the benchmark if an allocation was made when the path is expected not to allocate.
+class LoopCounters {
+public:
+    LoopCounters() {
+        AllocationTracker::get_instance().start();
+        perf_counters.start();
+    }
+
+    void report(benchmark::State& state, bool expect_no_allocations = false) {
+        perf_counters.stop();
+        uint64_t allocations = AllocationTracker::get_instance().get_total().count;
+        set_per_iteration(state, "allocations_per_iteration", allocations);
+
+        PerfCounts counts = perf_counters.read();
+        for (size_t i = 0; i < perf_events_count; i++) {
+            PerfEvent event = static_cast<PerfEvent>(i);
+            if (counts.is_available(event) && event != PerfEvent::instructions) {
+                set_per_iteration(state, std::string(get_perf_event_name(event)) + "_per_iteration",
+                                  counts.get(event));
+            }
+        }
+        if (counts.is_available(PerfEvent::cycles) && counts.is_available(PerfEvent::instructions) &&
+                counts.get(PerfEvent::cycles) > 0) {
+            state.counters["ipc"] = static_cast<double>(counts.get(PerfEvent::instructions)) /
+                                    counts.get(PerfEvent::cycles);
+        }
+
+        if (expect_no_allocations && allocations > 0) {
+            state.SkipWithError("allocated in a path expected not to allocate");
+        }
+    }
+
+private:
+    static void set_per_iteration(benchmark::State& state, const std::string& name, uint64_t value) {
+        state.counters[name] = benchmark::Counter(static_cast<double>(value), benchmark::Counter::kAvgIterations);
+    }
+
+    PerfCounters perf_counters;
+};
+
+static std::vector<Address> get_addresses(size_t count) {
+    std::vector<Address> addresses;
+    for (size_t i = 0; i < count; i++) {
+        addresses.push_back(Address("bench_miner_" + std::to_string(i)));
+    }
+    return addresses;
+}
+
+static nlohmann::json get_reward_scheme_args(const std::string& scheme, size_t records) {
+    if (scheme == "pplns") {
+        return {{"n", records}};
+    }
+    return nlohmann::json::object();
+}
+
+// Returns a pool of the given reward scheme in which each address submitted a share
+static std::shared_ptr<MiningPool> get_pool(std::shared_ptr<Network> network, const std::string& name,
+                                            const std::string& scheme,
+                                            const std::vector<Address>& addresses) {
+    auto reward_scheme = RewardSchemeFactory::create(scheme, get_reward_scheme_args(scheme, addresses.size()));
+    auto pool = MiningPool::create(name, 100, 0, std::move(reward_scheme), network);
+    network->register_pool(pool);
+    for (Address address : addresses) {
+        pool->join(address);
+        pool->get_reward_scheme().handle_share(address, Share(Share::Property::none));
+    }
+    return pool;
+}
+
+static void BM_EventQueue_schedule_pop(benchmark::State& state) {
+    SystemRandom::ensure_initialized(bench_seed);
+    auto random = SystemRandom::get_instance();
+    EventQueue queue;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        queue.schedule(Event(i, random->drand48()));
+    }
+    LoopCounters counters;
+    for (auto _ : state) {
+        Event event = queue.pop();
+        queue.schedule(Event(event.miner_id, event.time + random->drand48()));
+    }
+    counters.report(state, true);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EventQueue_schedule_pop)->Arg(10)->Arg(1000)->Arg(100000);
+
+// Shares which are not blocks are the steady state of every scheme, and must not allocate
+static void BM_RewardScheme_handle_share(benchmark::State& state, const std::string& scheme) {
+    SystemRandom::ensure_initialized(bench_seed);
+    auto network = std::make_shared<Network>(1000);
+    auto addresses = get_addresses(state.range(0));
+    auto pool = get_pool(network, "pool", scheme, addresses);
+    RewardScheme& reward_scheme = pool->get_reward_scheme();
+    size_t i = 0;
+    LoopCounters counters;
+    for (auto _ : state) {
+        reward_scheme.handle_share(addresses[i], Share(Share::Property::none));
+        if (++i == addresses.size()) {
+            i = 0;
+        }
+    }
+    counters.report(state, true);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_RewardScheme_handle_share, pps, std::string("pps"))->Arg(10)->Arg(1000)->Arg(100000);
+BENCHMARK_CAPTURE(BM_RewardScheme_handle_share, pplns, std::string("pplns"))->Arg(10)->Arg(1000)->Arg(100000);
+BENCHMARK_CAPTURE(BM_RewardScheme_handle_share, prop, std::string("prop"))->Arg(10)->Arg(1000)->Arg(100000);
+BENCHMARK_CAPTURE(BM_RewardScheme_handle_share, qb, std::string("qb"))->Arg(10)->Arg(1000)->Arg(100000);
+
+// Blocks are where schemes distribute rewards, usually over all the records
+static void BM_RewardScheme_handle_block(benchmark::State& state, const std::string& scheme) {
+    SystemRandom::ensure_initialized(bench_seed);
+    auto network = std::make_shared<Network>(1000);
+    auto addresses = get_addresses(state.range(0));
+    auto pool = get_pool(network, "pool", scheme, addresses);
+    RewardScheme& reward_scheme = pool->get_reward_scheme();
+    size_t i = 0;
+    LoopCounters counters;
+    for (auto _ : state) {
+        reward_scheme.handle_share(addresses[i], Share(Share::Property::valid_block));
+        if (++i == addresses.size()) {
+            i = 0;
+        }
+    }
+    counters.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_RewardScheme_handle_block, pps, std::string("pps"))->Arg(10)->Arg(1000)->Arg(100000);
+BENCHMARK_CAPTURE(BM_RewardScheme_handle_block, pplns, std::string("pplns"))->Arg(10)->Arg(1000)->Arg(100000);
+BENCHMARK_CAPTURE(BM_RewardScheme_handle_block, prop, std::string("prop"))->Arg(10)->Arg(1000)->Arg(100000);
+BENCHMARK_CAPTURE(BM_RewardScheme_handle_block, qb, std::string("qb"))->Arg(10)->Arg(1000)->Arg(100000);
+
+// Writing the miners of a pool must stay linear in their number, the reported complexity shows the fit
+static void BM_MiningPool_write_miners_metadata(benchmark::State& state) {
+    SystemRandom::ensure_initialized(bench_seed);
+    auto network = std::make_shared<Network>(1000);
+    auto pool = get_pool(network, "pool", "pps", get_addresses(state.range(0)));
+    LoopCounters counters;
+    for (auto _ : state) {
+        std::ostringstream output;
+        {
+            JSONWriter writer(output);
+            pool->write_miners_metadata(writer);
+        }
+        benchmark::DoNotOptimize(output);
+    }
+    counters.report(state);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_MiningPool_write_miners_metadata)->Arg(2500)->Arg(10000)->Arg(40000)->Complexity(benchmark::oN);
+
+// A miner of the given behavior in a QB pool of 100 default miners, with a second pool to hop to
+// One share out of 128 is a valid block, so that the decisions taken on blocks are included
+static void BM_ShareHandler_process_share(benchmark::State& state, const std::string& behavior,
+                                          const nlohmann::json& args) {
+    SystemRandom::ensure_initialized(bench_seed);
+    auto network = std::make_shared<Network>(1000);
+    auto pool = get_pool(network, "pool", "qb", get_addresses(100));
+    get_pool(network, "other_pool", "qb", {});
+    auto miner = Miner::create("bench_miner", 10, create_share_handler(behavior, args), network);
+    miner->join_pool(pool);
+    uint64_t i = 0;
+    LoopCounters counters;
+    for (auto _ : state) {
+        uint8_t flags = ++i % 128 == 0 ? Share::Property::valid_block : Share::Property::none;
+        miner->process_share(Share(flags));
+    }
+    counters.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_ShareHandler_process_share, default, std::string("default"),
+                  nlohmann::json::object());
+BENCHMARK_CAPTURE(BM_ShareHandler_process_share, share_withholding, std::string("share_withholding"),
+                  nlohmann::json::object());
+BENCHMARK_CAPTURE(BM_ShareHandler_process_share, qb_share_withholding, std::string("qb_share_withholding"),
+                  nlohmann::json::object());
+BENCHMARK_CAPTURE(BM_ShareHandler_process_share, share_donation, std::string("share_donation"),
+                  nlohmann::json({{"top_n", 1}, {"threshold", 0.9}}));
+BENCHMARK_CAPTURE(BM_ShareHandler_process_share, multiple_addresses, std::string("multiple_addresses"),
+                  nlohmann::json({{"top_n", 2}, {"threshold", 0.9}, {"addresses", 1}}));
+BENCHMARK_CAPTURE(BM_ShareHandler_process_share, qb_luck_pool_hopping, std::string("qb_luck_pool_hopping"),
+                  nlohmann::json({{"bad_luck_limit", 1}}));
+BENCHMARK_CAPTURE(BM_ShareHandler_process_share, qb_loss_pool_hopping, std::string("qb_loss_pool_hopping"),
+                  nlohmann::json::object());
+
+static void BM_Random_drand48(benchmark::State& state) {
+    SystemRandom::ensure_initialized(bench_seed);
+    auto random = SystemRandom::get_instance();
+    LoopCounters counters;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(random->drand48());
+    }
+    counters.report(state, true);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Random_drand48);
+
+static void BM_Random_random_uint64(benchmark::State& state) {
+    SystemRandom::ensure_initialized(bench_seed);
+    auto random = SystemRandom::get_instance();
+    LoopCounters counters;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(random->random_uint64());
+    }
+    counters.report(state, true);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Random_random_uint64);
+
+static void BM_Distribution_get(benchmark::State& state, const std::string& name, const nlohmann::json& args) {
+    SystemRandom::ensure_initialized(bench_seed);
+    auto distribution = DistributionFactory::create(name, args);
+    LoopCounters counters;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(distribution->get());
+    }
+    counters.report(state, true);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_Distribution_get, uniform, std::string("uniform"),
+                  nlohmann::json({{"low", 0.0}, {"high", 10.0}}));
+BENCHMARK_CAPTURE(BM_Distribution_get, normal, std::string("normal"),
+                  nlohmann::json({{"mean", 10.0}, {"stddev", 1.5}}));
+BENCHMARK_CAPTURE(BM_Distribution_get, lognormal, std::string("lognormal"),
+                  nlohmann::json({{"mean", 0.95909}, {"stddev", 1.742}}));
+
+// Simulation of a QB pool with the given number of default miners and a 1% chance of a block per share
+static Simulation get_bench_simulation(int64_t miners_count) {
+    auto config = R"({
+      "output": "bench_results.json",
+      "blocks": 1000000000,
+      "network_difficulty": 10000,
+      "output_options": {"detail": "summary", "hop_events": false},
+      "pools": [{
+        "uncle_block_prob": 0.0,
+        "difficulty": 100,
+        "reward_scheme": {"type": "qb", "params": {}},
+        "miners": [{
+          "generator": "random",
+          "params": {
+            "behavior": {"name": "default"},
+            "hashrate": {"distribution": "normal", "params": {"mean": 10.0, "stddev": 1.5, "minimum": 1.0}},
+            "stop_condition": {"type": "miners_count", "params": {"value": 0}}
+          }
+        }]
+      }]
+    })"_json;
+    config["pools"][0]["miners"][0]["params"]["stop_condition"]["params"]["value"] = miners_count;
+    return config.get<Simulation>();
+}
+
+static void BM_Simulator_process_event(benchmark::State& state) {
+    SystemRandom::ensure_initialized(bench_seed);
+    auto simulator = std::make_shared<Simulator>(get_bench_simulation(state.range(0)));
+    simulator->initialize();
+    simulator->schedule_all();
+    LoopCounters counters;
+    for (auto _ : state) {
+        simulator->process_event(simulator->pop_next_event());
+    }
+    counters.report(state);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Simulator_process_event)->Arg(10)->Arg(1000)->Arg(100000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,207 @@
+"""
+script to benchmark whole simulations of the example configs at increasing scales
+
+Each config is run once at its base scale and once per point of each axis,
+the other axes staying at their base value:
+- miners: number of miners of each random generator of each pool
+- pools: number of pools, the pools of the config being repeated under suffixed names
+- blocks: number of blocks to simulate
+
+Only random generators are scaled and repeated, so that addresses stay unique,
+and configs without any are only run along the blocks axis.
+Results are written as NDJSON, whatever the output of the config.
+For each point, the shares simulated, events (shares) per second, ns per share,
+IPC and hardware events per share, peak RSS and output bytes are written as CSV or JSON
+depending on the extension of --output.
+Hardware events and the peak RSS are reported by poolsim --perf-counters, events being left
+empty when the kernel does not allow counting them (see kernel.perf_event_paranoid).
+The defaults go up to 10^6 miners and 1000 pools, which takes hours for all the examples.
+
+usage: python run_scenarios.py --miners 10,1000,100000 --pools 1,10,100 --blocks 1000,10000
+"""
+
+import argparse
+import copy
+import csv
+import glob
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+FIELDS = [
+    "config", "axis", "miners", "pools", "blocks", "status",
+    "shares", "runtime_milliseconds", "wall_seconds",
+    "events_per_second", "ns_per_share", "ipc", "cycles_per_share", "l1d_misses_per_share",
+    "llc_misses_per_share", "branch_misses_per_share", "peak_rss_bytes", "output_bytes",
+]
+
+PERF_EVENTS = ["cycles", "l1d_misses", "llc_misses", "branch_misses"]
+
+
+def parse_list(value):
+    return [int(v) for v in value.split(",") if v]
+
+
+def random_generators(config):
+    return [m for pool in config["pools"] for m in pool["miners"] if m["generator"] == "random"]
+
+
+def scale(config, miners=None, pools=None, blocks=None):
+    config = copy.deepcopy(config)
+    if blocks is not None:
+        config["blocks"] = blocks
+    if miners is not None:
+        for generator in random_generators(config):
+            generator["params"]["stop_condition"] = {"type": "miners_count", "params": {"value": miners}}
+    if pools is not None:
+        base_pools = config["pools"]
+        config["pools"] = []
+        for i in range(pools):
+            pool = copy.deepcopy(base_pools[i % len(base_pools)])
+            if i >= len(base_pools):
+                pool["miners"] = [m for m in pool["miners"] if m["generator"] == "random"]
+                # results refer to pools by name, unnamed pools being named after their index
+                if pool.get("name"):
+                    pool["name"] = "{}-{}".format(pool["name"], i)
+            config["pools"].append(pool)
+    return config
+
+
+def count_miners(config):
+    counts = [g["params"]["stop_condition"]["params"]["value"] for g in random_generators(config)
+              if g["params"]["stop_condition"]["type"] == "miners_count"]
+    return max(counts) if counts else None
+
+
+def read_results(filepath):
+    """returns the number of shares submitted to pools, the runtime, the peak RSS
+    and the hardware events of the simulation"""
+    shares, runtime, peak_rss, perf_counters = 0, None, None, {}
+    with open(filepath) as f:
+        for line in f:
+            data = json.loads(line)
+            if data["type"] == "pool":
+                shares += sum(m["metadata"]["share_count"] for m in data["miners"] or [])
+            elif data["type"] == "summary":
+                runtime = data["runtime_milliseconds"]
+                peak_rss = data.get("peak_rss_bytes")
+                perf_counters = data.get("perf_counters", {})
+    return shares, runtime, peak_rss, perf_counters
+
+
+def run_point(poolsim, config_path, config, timeout, workdir):
+    config = copy.deepcopy(config)
+    output = os.path.join(workdir, "results.ndjson")
+    config["output"] = output
+    scaled_path = os.path.join(workdir, "config.json")
+    with open(scaled_path, "w") as f:
+        json.dump(config, f)
+
+    point = dict(status="ok")
+    start = time.monotonic()
+    # the config directory is the working directory so that relative CSV paths still work
+    process = subprocess.Popen(
+        [poolsim, "-c", scaled_path, "-s", str(config.get("seed", 1)), "--perf-counters"],
+        cwd=os.path.dirname(os.path.abspath(config_path)),
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+    )
+    try:
+        process.wait(timeout=timeout)
+    except subprocess.TimeoutExpired:
+        process.kill()
+        process.wait()
+        point["status"] = "timeout"
+    point["wall_seconds"] = round(time.monotonic() - start, 3)
+    if point["status"] == "ok" and process.returncode != 0:
+        point["status"] = "failed"
+    if point["status"] != "ok":
+        return point
+
+    point["output_bytes"] = os.path.getsize(output)
+    # the RSS seen by wait4 would include the pages of this script, shared with the forked child
+    shares, runtime, point["peak_rss_bytes"], perf_counters = read_results(output)
+    point["shares"] = shares
+    point["runtime_milliseconds"] = runtime
+    if shares > 0 and runtime:
+        point["events_per_second"] = round(shares / (runtime / 1000.0))
+        point["ns_per_share"] = round(runtime * 1e6 / shares, 1)
+    if perf_counters.get("ipc") is not None:
+        point["ipc"] = round(perf_counters["ipc"], 3)
+    for event in PERF_EVENTS:
+        if shares > 0 and perf_counters.get(event) is not None:
+            point[event + "_per_share"] = round(perf_counters[event] / shares, 3)
+    return point
+
+
+def get_points(config, args):
+    base_blocks = min(config["blocks"], args.base_blocks)
+    base = scale(config, blocks=base_blocks)
+    points = [("base", base)]
+    scalable = len(random_generators(config)) > 0
+    for miners in args.miners if scalable else []:
+        points.append(("miners", scale(base, miners=miners)))
+    for pools in args.pools if scalable else []:
+        points.append(("pools", scale(base, pools=pools)))
+    for blocks in args.blocks:
+        points.append(("blocks", scale(base, blocks=blocks)))
+    return points
+
+
+def write_results(rows, filepath):
+    if filepath == "-":
+        writer = csv.DictWriter(sys.stdout, fieldnames=FIELDS)
+        writer.writeheader()
+        writer.writerows(rows)
+    elif filepath.endswith(".json"):
+        with open(filepath, "w") as f:
+            json.dump(rows, f, indent=2)
+    else:
+        with open(filepath, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=FIELDS)
+            writer.writeheader()
+            writer.writerows(rows)
+
+
+def main():
+    parser = argparse.ArgumentParser(prog="run-scenarios")
+    parser.add_argument("configs", nargs="*", help="configs to run, all the examples by default")
+    parser.add_argument("--poolsim", default=os.path.join(ROOT, "build", "poolsim"), help="poolsim executable")
+    parser.add_argument("--miners", type=parse_list, default=[10, 100, 1000, 10000, 100000, 1000000],
+                        help="comma separated miners per random generator")
+    parser.add_argument("--pools", type=parse_list, default=[1, 10, 100, 1000], help="comma separated pool counts")
+    parser.add_argument("--blocks", type=parse_list, default=[1000, 10000], help="comma separated block counts")
+    parser.add_argument("--base-blocks", type=int, default=1000,
+                        help="blocks simulated along the miners and pools axes")
+    parser.add_argument("--timeout", type=float, default=600, help="seconds before a point is abandoned")
+    parser.add_argument("--output", default="-", help="CSV or JSON (.json) file, stdout by default")
+    args = parser.parse_args()
+
+    configs = args.configs or sorted(glob.glob(os.path.join(ROOT, "examples", "*", "*.json")))
+    rows = []
+    for config_path in configs:
+        with open(config_path) as f:
+            config = json.load(f)
+        name = os.path.relpath(os.path.abspath(config_path), ROOT)
+        for axis, point_config in get_points(config, args):
+            workdir = tempfile.mkdtemp(prefix="poolsim-scenario-")
+            try:
+                point = run_point(args.poolsim, config_path, point_config, args.timeout, workdir)
+            finally:
+                shutil.rmtree(workdir)
+            point.update(config=name, axis=axis, miners=count_miners(point_config),
+                         pools=len(point_config["pools"]), blocks=point_config["blocks"])
+            print("{config} {axis} miners={miners} pools={pools} blocks={blocks}: {status}".format(**point),
+                  file=sys.stderr)
+            rows.append(point)
+    write_results(rows, args.output)
+
+
+if __name__ == "__main__":
+    main()
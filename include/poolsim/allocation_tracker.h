@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include <nlohmann/json.hpp>
+
+#include "profiler.h"
+
+namespace poolsim {
+
+// Stages of a simulation allocations are attributed to
+enum class SimulationStage : uint8_t {
+    initialize,
+    run,
+    save
+};
+
+const size_t simulation_stages_count = 3;
+
+// Returns the name of the stage in the allocation report
+const char* get_stage_name(SimulationStage stage);
+
+struct AllocationCount {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// Counts the allocations made by the thread which started tracking
+// Allocations are only seen when operator new is replaced by one calling
+// record_allocation, as done by poolsim-instrumented and the benchmarks.
+// They are attributed to the current stage and, in builds with POOLSIM_PROFILE,
+// to the innermost phase being profiled. Allocations of other threads,
+// e.g. the output threads, are only counted in total.
+class AllocationTracker {
+public:
+    static AllocationTracker& get_instance();
+
+    // Starts tracking the allocations of the calling thread, from the initialize stage
+    void start();
+
+    // Called on every allocation, must not allocate
+    void record_allocation(size_t size);
+
+    void set_stage(SimulationStage stage);
+
+    // Allocations of the tracked thread since it started
+    AllocationCount get_total() const;
+    AllocationCount get_stage(SimulationStage stage) const;
+    AllocationCount get_phase(ProfilePhase phase) const;
+    // Allocations made outside any phase
+    AllocationCount get_unprofiled() const;
+    // Allocations of other threads
+    AllocationCount get_other_threads() const;
+private:
+    static AllocationTracker instance;
+
+    SimulationStage stage = SimulationStage::initialize;
+    AllocationCount stages[simulation_stages_count];
+    AllocationCount phases[profile_phases_count];
+    AllocationCount unprofiled;
+    std::atomic<uint64_t> other_threads_count{0};
+    std::atomic<uint64_t> other_threads_bytes{0};
+};
+
+// Report with the allocations per stage and phase, and per share if shares is not 0
+nlohmann::json get_allocation_report(const AllocationTracker& tracker, uint64_t shares);
+
+}
@@ -1,14 +1,15 @@
 #pragma once
 
-#include <string>
+#include <cstdint>
 
 namespace poolsim {
 
 struct Event {
-  Event(const std::string& miner_address, double _time);
+  Event(uint32_t miner_id, double _time);
 
-  std::string miner_address;
   double time;
+  // ID of the miner in the simulator miner table
+  uint32_t miner_id;
 };
 
 // Class used to compare Events in priority_queue
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+namespace poolsim {
+
+// size of the input compressed by each thread at a time
+const size_t gzip_block_size = 1 << 17;
+
+// Compresses its input to a gzip file with a pool of threads
+//
+// The input is cut into blocks which are deflated independently, using the
+// end of the previous block as dictionary, and written to the file in order as
+// a single gzip member. Blocks are compressed while the caller keeps writing.
+class GzipStreamBuffer : public std::streambuf {
+public:
+    // Uses one thread per core when threads is 0
+    GzipStreamBuffer(const std::string& filepath, unsigned int threads = 0,
+                     size_t block_size = gzip_block_size);
+    ~GzipStreamBuffer();
+
+    GzipStreamBuffer(GzipStreamBuffer const&) = delete;
+    void operator=(GzipStreamBuffer const&) = delete;
+
+    // Compresses the remaining input and completes the file
+    // Throws if the file could not be written
+    void close();
+
+protected:
+    int_type overflow(int_type c) override;
+
+private:
+    struct Block {
+        std::string input;
+        // end of the previous input, used as deflate dictionary
+        std::string dictionary;
+        bool last = false;
+
+        std::string output;
+        uint32_t crc = 0;
+        bool done = false;
+        std::string error;
+    };
+
+    // Queues the buffered input for compression
+    void submit_block(bool last);
+    // Writes the compressed blocks at the front of pending,
+    // waiting for threads until at most max_blocks are left
+    void write_blocks(size_t max_blocks);
+    void write_header();
+    void write_trailer();
+    void stop_workers();
+    void run_worker();
+
+    static void compress_block(Block& block);
+
+    std::string filepath;
+    std::ofstream file;
+    std::vector<char> buffer;
+    std::string dictionary;
+
+    // blocks not yet written to the file, in input order
+    std::deque<std::shared_ptr<Block>> pending;
+    // blocks waiting for a thread
+    std::deque<std::shared_ptr<Block>> queue;
+    size_t max_pending;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable block_queued;
+    std::condition_variable block_done;
+    bool stopping = false;
+    bool closed = false;
+
+    // checksum and size of the input written so far
+    uint32_t crc = 0;
+    uint64_t input_size = 0;
+};
+
+// Output stream writing a gzip file compressed by GzipStreamBuffer
+class GzipOutputStream : public std::ostream {
+public:
+    explicit GzipOutputStream(const std::string& filepath, unsigned int threads = 0,
+                              size_t block_size = gzip_block_size);
+
+    // Completes the file, done by the destructor otherwise,
+    // but errors are only reported here
+    void close();
+
+private:
+    GzipStreamBuffer buffer;
+};
+
+}
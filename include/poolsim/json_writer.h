@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+#include <nlohmann/json.hpp>
+
+#include "address.h"
+
+namespace poolsim {
+
+// Writes JSON to a stream as it goes, without building a document
+// The output is byte for byte what nlohmann::json::dump produces with
+// the same indentation, as long as object keys are written in sorted order
+class JSONWriter {
+public:
+    // A negative indent writes compact JSON
+    JSONWriter(std::ostream& output, int indent = -1);
+    ~JSONWriter();
+
+    void start_object();
+    void end_object();
+    void start_array();
+    void end_array();
+
+    // Writes the key of the next value of the current object
+    void key(const char* name);
+
+    void value(const std::string& value);
+    void value(const char* value);
+    void value(Address value);
+    void value(bool value);
+    void value(double value);
+    void value(uint64_t value);
+    void value(int64_t value);
+    void value(std::nullptr_t value);
+    // Writes a value which is already a JSON document
+    void value(const nlohmann::json& value);
+
+    // Writes the text as is, e.g. to separate top-level documents
+    void raw(const char* text);
+
+    // Writes the buffered output to the stream
+    void flush();
+
+    // Returns the number of bytes written so far, including buffered ones
+    uint64_t get_offset() const;
+private:
+    // Writes the separator and indentation before a value or a key
+    void prefix();
+    void newline(size_t depth);
+    void write(const char* data, size_t size);
+    void write_string(const char* value, size_t size);
+
+    struct Scope {
+        bool is_object;
+        size_t count;
+    };
+
+    std::ostream& output;
+    int indent;
+    std::string buffer;
+    // number of bytes already written to the stream
+    uint64_t flushed = 0;
+    std::vector<Scope> scopes;
+    // true right after a key, when the value must follow on the same line
+    bool after_key = false;
+};
+
+}
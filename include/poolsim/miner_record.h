@@ -5,11 +5,14 @@
 #include <cstdint>
 #include <nlohmann/json.hpp>
 
+#include "address.h"
+#include "json_writer.h"
+
 namespace poolsim {
 
 class MinerRecord {
 public:
-    MinerRecord(std::string _address);
+    MinerRecord(Address _address);
 
     // increments balance of blocks mined by miner
     void inc_blocks_mined();
@@ -28,7 +31,7 @@ public:
     // resets the number of shares submitted per round by miner to zero
     void reset_shares_per_round();
     // returns address of miner to which record belongs
-    std::string get_miner_address() const;
+    Address get_miner_address() const;
     // returns the number of shares submitted
     uint64_t get_shares_count() const;
     // returns the number of uncle blocks mined by the miner
@@ -48,12 +51,12 @@ protected:
     
     double blocks_received = 0, uncles_received = 0;
 
-    std::string address;
+    Address address;
 };
 
 class QBRecord : public MinerRecord {
 public:
-    QBRecord(std::string miner_address);
+    QBRecord(Address miner_address);
     // increments credits by amount '_credits'
     void inc_credits(uint64_t _credits);
     // sets credits of a miner to function argument 'balance'
@@ -77,5 +80,6 @@ public:
 };
 
 void to_json(nlohmann::json& j, const MinerRecord& data);
+void write_json(JSONWriter& writer, const MinerRecord& data);
 
 }
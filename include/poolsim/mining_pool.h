@@ -1,6 +1,5 @@
 #pragma once
 
-#include <set>
 #include <string>
 #include <memory>
 #include <cstdint>
@@ -11,6 +10,10 @@
 #include "random.h"
 #include "observer.h"
 #include "block_event.h"
+#include "address.h"
+#include "json_writer.h"
+#include "pool_membership.h"
+#include "profiler.h"
 
 
 namespace poolsim {
@@ -33,8 +36,11 @@ public:
         std::shared_ptr<Network> network,
         std::shared_ptr<Random> random);
 
-    // Returns all the miners currently in the pool
-    std::set<std::string> get_miners();
+    // Returns all the miners currently in the pool, in join order
+    const PoolMembership& get_miners() const;
+
+    // Returns true if the address has joined the pool
+    bool has_miner(Address miner_address) const;
 
     // Returns the name of the reward scheme used by the pool
     std::string get_scheme_name() const;
@@ -54,6 +60,9 @@ public:
     // Returns the network instance
     std::shared_ptr<Network> get_network() const;
 
+    // Returns the reward scheme of the pool
+    RewardScheme& get_reward_scheme() const;
+
     // Returns the current reward scheme
     template <typename RewardSchemeClass>
     std::vector<std::shared_ptr<typename RewardSchemeClass::record_class>> get_records();
@@ -66,15 +75,21 @@ public:
     // The share can be either a network share or a pool share
     // TODO: when the share is a network share this should probably return
     // if it became an uncle block or not
-    void submit_share(const std::string& miner_address, const Share& share);
+    void submit_share(Address miner_address, const Share& share);
+
+    // Same as submit_share, but calls the reward scheme without virtual dispatch
+    // RewardSchemeClass must be the exact type of the pool reward scheme
+    template <typename RewardSchemeClass>
+    void submit_share(Address miner_address, const Share& share);
 
     // Joins this mining pool
     // This method does not update the miner state
-    void join(const std::string& miner);
+    // and is a no-op if the address is already in the pool
+    void join(Address miner_address);
 
     // Leaves this mining pool
     // This method does not update the miner state
-    void leave(const std::string& miner_address);
+    void leave(Address miner_address);
 
     // Set the reward scheme for this mining pool
     void set_reward_scheme(std::unique_ptr<RewardScheme> _reward_scheme);
@@ -82,9 +97,16 @@ public:
     // Returns the metadata of all miners in the poool
     nlohmann::json get_miners_metadata() const;
 
+    // Writes the metadata of all miners in the pool
+    // The offset at which each miner is written is added to miner_offsets, if set
+    void write_miners_metadata(JSONWriter& writer, std::vector<uint64_t>* miner_offsets = nullptr) const;
+
     // Returns the total number of blocks mined
     uint64_t get_blocks_mined() const;
 
+    // Returns the total number of shares submitted to the pool
+    uint64_t get_shares_submitted() const;
+
 protected:
     MiningPool(const std::string& name, uint64_t difficulty,
                double uncle_prob,
@@ -95,7 +117,7 @@ private:
     // name of pool
     std::string pool_name;
     // list of miners in pool
-    std::set<std::string> miners;
+    PoolMembership miners;
     // share and network difficulty; total hashrate of pool
     uint64_t difficulty;
     // probability that a block is an uncle
@@ -104,6 +126,8 @@ private:
     std::unique_ptr<RewardScheme> reward_scheme;
     // total blocks mined by miners in pool
     uint64_t blocks_mined = 0;
+    // total shares submitted by miners in pool
+    uint64_t shares_submitted = 0;
     // Information about network
     std::weak_ptr<Network> network;
     // Random instance
@@ -112,6 +136,12 @@ private:
 
 void to_json(nlohmann::json& j, const MiningPool& data);
 
+// Writes the same JSON as to_json, keys excluded from the enclosing object for the _fields variant
+void write_json(JSONWriter& writer, const MiningPool& data,
+                std::vector<uint64_t>* miner_offsets = nullptr);
+void write_json_fields(JSONWriter& writer, const MiningPool& data,
+                       std::vector<uint64_t>* miner_offsets = nullptr);
+
 template <typename RewardSchemeClass>
 std::vector<std::shared_ptr<typename RewardSchemeClass::record_class>> MiningPool::get_records() {
     auto reward_scheme_ptr = reward_scheme.get();
@@ -119,6 +149,34 @@ std::vector<std::shared_ptr<typename RewardSchemeClass::record_class>> MiningPoo
     return downcasted_reward_scheme->get_records();
 }
 
+template <typename RewardSchemeClass>
+void MiningPool::submit_share(Address miner_address, const Share& submitted_share) {
+    Share share = submitted_share;
+    shares_submitted++;
+    if (share.is_valid_block() && random->drand48() < uncle_prob) {
+        share = Share(share.get_properties() | Share::Property::uncle);
+    }
+    if (share.is_network_share()) {
+        blocks_mined++;
+    }
+    {
+        POOLSIM_PROFILE_SCOPE(reward_scheme);
+        dispatch_share<RewardSchemeClass>(*reward_scheme, miner_address, share);
+    }
+    if (share.is_valid_block() && has_observers()) {
+        POOLSIM_PROFILE_SCOPE(block_notification);
+        BlockEvent block_event {
+            .time = 0,
+            .is_uncle = share.is_uncle(),
+            .pool_name = &pool_name,
+            .miner_address = miner_address,
+            .reward_scheme_data_type = reward_scheme->get_block_data_type(),
+            .reward_scheme_data = &reward_scheme->get_block_data()
+        };
+        notify(block_event);
+    }
+}
+
 template <typename RewardSchemeClass>
 typename RewardSchemeClass::block_metadata_class MiningPool::get_block_metadata() {
     auto reward_scheme_ptr = reward_scheme.get();
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "address.h"
+#include "json_writer.h"
+
+namespace poolsim {
+
+// Assigns IDs to pool names in the order in which they first appear
+class PoolNameDictionary {
+public:
+    // Returns the ID of the name, adding it if needed
+    uint32_t get_id(const std::string& name);
+
+    // Returns the names of the dictionary, indexed by ID
+    const std::vector<std::string>& get_names() const;
+
+    // Returns the bytes held by the names
+    uint64_t get_memory_usage() const;
+private:
+    std::vector<std::string> names;
+};
+
+// Pool names and addresses referred to by ID in dictionary encoded results
+struct OutputDictionary {
+    PoolNameDictionary pool_names;
+    AddressDictionary addresses;
+
+    // Returns the bytes held by both dictionaries
+    uint64_t get_memory_usage() const;
+};
+
+// Writes the pool name under name_key, or its ID under id_key if dictionary is set
+void write_pool_name(JSONWriter& writer, const char* name_key, const char* id_key,
+                     const std::string& name, OutputDictionary* dictionary);
+
+// Writes the address under address_key, or its ID under id_key if dictionary is set
+// The null address gets a null ID
+void write_address(JSONWriter& writer, const char* address_key, const char* id_key,
+                   Address address, OutputDictionary* dictionary);
+
+}
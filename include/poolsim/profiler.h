@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+#include <nlohmann/json.hpp>
+
+namespace poolsim {
+
+// Phases of Simulator::run timed by the profiler
+enum class ProfilePhase : uint8_t {
+    // the event loop itself, its self time is what no other phase accounts for
+    run,
+    event_pop,
+    scheduling,
+    random,
+    share_handler,
+    reward_scheme,
+    block_notification,
+    output
+};
+
+const size_t profile_phases_count = 8;
+
+// Returns the name of the phase in the profile
+const char* get_phase_name(ProfilePhase phase);
+
+// Time and calls accumulated for a phase
+struct PhaseProfile {
+    uint64_t calls = 0;
+    // time spent in the phase, including the phases it calls
+    uint64_t total_nanoseconds = 0;
+    // time spent in the phase itself
+    uint64_t self_nanoseconds = 0;
+};
+
+class ProfileScope;
+
+// Accumulates the time spent in each phase of the simulation thread
+// Phases are timed by ProfileScope, only when libpoolsim is built with
+// POOLSIM_PROFILE defined (./configure --profile), so that the default
+// build pays nothing for it
+class Profiler {
+friend class ProfileScope;
+
+public:
+    static Profiler& get_instance();
+
+    // Clears all the phases
+    void reset();
+
+    const PhaseProfile& get_phase(ProfilePhase phase) const;
+
+    // Innermost scope being timed, nullptr outside of any phase
+    const ProfileScope* get_current() const { return current; }
+
+private:
+    static Profiler instance;
+
+    PhaseProfile phases[profile_phases_count];
+    // innermost scope being timed
+    ProfileScope* current = nullptr;
+};
+
+// Times a phase from its construction to its destruction
+class ProfileScope {
+public:
+    explicit ProfileScope(ProfilePhase _phase)
+        : phase(_phase), parent(Profiler::instance.current),
+          start(std::chrono::steady_clock::now()) {
+        Profiler::instance.current = this;
+    }
+
+    ~ProfileScope() {
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        PhaseProfile& profile = Profiler::instance.phases[static_cast<size_t>(phase)];
+        profile.calls++;
+        profile.total_nanoseconds += elapsed;
+        profile.self_nanoseconds += elapsed - children_nanoseconds;
+        if (parent != nullptr) {
+            parent->children_nanoseconds += elapsed;
+        }
+        Profiler::instance.current = parent;
+    }
+
+    ProfileScope(ProfileScope const&) = delete;
+    void operator=(ProfileScope const&) = delete;
+
+    ProfilePhase get_phase() const { return phase; }
+
+private:
+    ProfilePhase phase;
+    ProfileScope* parent;
+    uint64_t children_nanoseconds = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+void to_json(nlohmann::json& j, const Profiler& profiler);
+
+#define POOLSIM_CONCAT_IMPL(a, b) a##b
+#define POOLSIM_CONCAT(a, b) POOLSIM_CONCAT_IMPL(a, b)
+
+// Times the rest of the enclosing scope as the given ProfilePhase
+#ifdef POOLSIM_PROFILE
+#define POOLSIM_PROFILE_SCOPE(phase) \
+    ::poolsim::ProfileScope POOLSIM_CONCAT(profile_scope_, __LINE__)(::poolsim::ProfilePhase::phase)
+#else
+#define POOLSIM_PROFILE_SCOPE(phase)
+#endif
+
+}
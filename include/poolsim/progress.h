@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+namespace poolsim {
+
+// default seconds between two progress reports
+const double default_progress_interval = 10.0;
+
+// Returns the resident set size of the process, 0 if it cannot be read
+uint64_t get_current_rss_bytes();
+
+// Returns the peak resident set size of the process, 0 if it cannot be read
+// On Linux, memory of the parent process which forked it is not included
+uint64_t get_peak_rss_bytes();
+
+// State of a running simulation, as known by the simulator
+struct ProgressStatus {
+    uint64_t blocks;
+    uint64_t target_blocks;
+    // every event is a share found by a miner
+    uint64_t events;
+    // shares submitted to pools, fewer than events when miners withhold shares
+    uint64_t shares;
+    size_t queue_size;
+    bool done;
+};
+
+// Reports the progress of a simulation at a wall time interval, as JSON objects
+// with the events and shares throughput since the previous report, the estimated time left and the RSS
+// Reports are either written as lines to stderr, with "-" as destination,
+// or replace the content of the destination file atomically, so that the
+// file can be polled by other processes at any time
+class ProgressReporter {
+public:
+    ProgressReporter(const std::string& destination, double interval_seconds = default_progress_interval);
+
+    // Returns true if the interval elapsed since the last report
+    bool is_due() const {
+        return std::chrono::steady_clock::now() >= next_report;
+    }
+
+    // Writes a report, throws if the destination file cannot be written
+    void report(const ProgressStatus& status);
+
+    // Returns the report for the given status, without writing it
+    nlohmann::json get_report(const ProgressStatus& status,
+                              std::chrono::steady_clock::time_point now) const;
+
+private:
+    void write(const std::string& line) const;
+
+    std::string destination;
+    std::chrono::steady_clock::duration interval;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point next_report;
+
+    // state at the previous report, for the current throughput
+    std::chrono::steady_clock::time_point last_report;
+    uint64_t last_events = 0;
+    uint64_t last_shares = 0;
+};
+
+}
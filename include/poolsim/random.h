@@ -3,8 +3,10 @@
 #include <random>
 #include <memory>
 #include <iterator>
+#include <cstdint>
 
 #include "factory.h"
+#include "address.h"
 #include <nlohmann/json.hpp>
 
 namespace poolsim {
@@ -29,11 +31,15 @@ public:
     virtual double drand48() = 0;
 
     // Returns a random address (0x prefix + 40 hex chars)
-    virtual std::string get_address() = 0;
+    virtual Address get_address() = 0;
 
     // returns a random integer between min and max
     virtual int random_int(int min, int max) = 0;
 
+    // Returns a random integer uniform over the full 64-bit range
+    // The default widens drand48() so both draw from the same stream
+    virtual uint64_t random_uint64();
+
     // returns a random element from a container
     template<typename It>
     typename std::iterator_traits<It>::reference random_element(It begin, It end);
@@ -61,7 +67,7 @@ public:
   static void ensure_initialized(long seed);
   static std::shared_ptr<SystemRandom> get_instance();
 
-  std::string get_address() override;
+  Address get_address() override;
 
   // Delegates to standard drand48()
   double drand48() override;
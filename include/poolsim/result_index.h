@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+#include "address.h"
+#include "columnar.h"
+
+namespace poolsim {
+
+// Format of the results a ResultIndex refers to
+enum class ResultFormat : uint8_t {
+    json = 1,
+    ndjson = 2,
+    columnar = 3
+};
+
+// position of a miner without data in the results
+const uint64_t no_result_position = UINT64_MAX;
+
+// Returns the path of the index written next to the results
+std::string get_index_filepath(const std::string& results_filepath);
+
+// Collects the position of the data of each address in a result file
+// Positions are byte offsets for JSON and NDJSON results and row IDs for columnar ones
+class ResultIndexWriter {
+public:
+    explicit ResultIndexWriter(ResultFormat format);
+
+    // Adds a pool, which gets the next pool ID
+    void add_pool(const std::string& name, uint64_t difficulty);
+    uint32_t get_pools_count() const;
+
+    void add_miner(Address address, uint64_t position);
+
+    void add_pool_miner(uint32_t pool_id, Address address, uint64_t position);
+
+    // Writes the index as a columnar file, with addresses sorted
+    void write(const std::string& filepath) const;
+private:
+    struct Entry {
+        uint64_t miner_position = no_result_position;
+        // pool ID and position of the miner in the pool
+        std::vector<std::pair<uint32_t, uint64_t>> pools;
+    };
+
+    ResultFormat format;
+    std::map<std::string, Entry> entries;
+    std::vector<std::string> pool_names;
+    std::vector<uint64_t> pool_difficulties;
+};
+
+// Position of the data of a miner in a result file
+struct IndexedMiner {
+    uint64_t miner_position;
+    // pool ID and position of the miner in the pool
+    std::vector<std::pair<uint32_t, uint64_t>> pools;
+};
+
+// Reads an index written by ResultIndexWriter
+class ResultIndex {
+public:
+    explicit ResultIndex(const std::string& filepath);
+
+    ResultFormat get_format() const;
+
+    // Returns false if the address is not in the index
+    bool find(const std::string& address, IndexedMiner& miner) const;
+
+    std::string get_pool_name(uint32_t pool_id) const;
+    uint64_t get_pool_difficulty(uint32_t pool_id) const;
+private:
+    ColumnarReader reader;
+};
+
+// Aggregated results of a miner over all its pools, as given by scripts/get_miner_info.py
+struct MinerInfo {
+    uint64_t blocks_mined = 0;
+    double blocks_received = 0;
+    double blocks_ratio = 0;
+    double work_per_block = 0;
+    // work per block received in each pool, by pool name
+    std::map<std::string, double> work_in_pool_per_block;
+    double work_per_block_solo = 0;
+};
+
+// Computes the results of a miner using the index next to the results,
+// reading only the data of this miner
+// Throws std::invalid_argument if the miner is not in the results
+MinerInfo query_miner_info(const std::string& results_filepath, const std::string& address);
+
+void to_json(nlohmann::json& j, const MinerInfo& info);
+
+}
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+#include "address.h"
+#include "block_event.h"
+#include "mining_pool.h"
+#include "miner.h"
+#include "share_handler.h"
+#include "json_writer.h"
+#include "output_dictionary.h"
+#include "profiler.h"
+#include "perf_counters.h"
+#include "memory_usage.h"
+
+namespace poolsim {
+
+// State of a pool at some point of the simulation
+struct PoolSnapshot {
+    double time;
+    // number of blocks found in the network so far
+    uint64_t block;
+    std::string pool_name;
+    uint64_t blocks_mined;
+    uint64_t miners_count;
+    double luck;
+};
+
+// Destination of the results of a simulation
+// Blocks are written while the simulation runs, pools and miners
+// once it is over
+class ResultWriter {
+public:
+    virtual ~ResultWriter();
+
+    // Creates the writer for the output file, based on its extension
+    // .ndjson (optionally .ndjson.gz) streams results, .psim uses the binary
+    // columnar format and anything else is written as a single JSON document,
+    // indented unless compact is set. Only the BlockField in block_fields are written.
+    // With dictionary_encoding, JSON and NDJSON events refer to pool names and
+    // addresses by ID, as columnar results always do.
+    static std::unique_ptr<ResultWriter> create(const std::string& filepath, bool compact = false,
+                                                uint8_t block_fields = BlockField::all,
+                                                bool dictionary_encoding = false);
+
+    // Writes a block found during the simulation
+    virtual void write_block(const BlockEvent& block_event) = 0;
+
+    // Writes a miner moving to another pool, ignored by default
+    virtual void write_hop(const HopEvent& hop_event);
+
+    // Writes the state of a pool during the simulation, ignored by default
+    virtual void write_snapshot(const PoolSnapshot& snapshot);
+
+    // Keeps the time spent in each phase of the simulation, written by finish
+    // as a "profile" section. Only called by simulators built with POOLSIM_PROFILE.
+    virtual void write_profile(const Profiler& profiler);
+
+    // Keeps the hardware events counted during the simulation, written by finish
+    // as a "perf_counters" section
+    virtual void write_perf_counters(const PerfCounts& counts);
+
+    // Keeps the peak resident set size of the simulation, written by finish as "peak_rss_bytes"
+    virtual void write_peak_rss(uint64_t bytes);
+
+    // Adds the estimated bytes held by the writer, nothing by default
+    virtual void add_memory_usage(MemoryUsage& usage) const;
+
+    // Writes the final state of the pools and miners and closes the output
+    // Uncompressed results also get an index of their miners (see result_index.h)
+    virtual void finish(int64_t runtime_milliseconds,
+                        const std::vector<std::shared_ptr<MiningPool>>& pools,
+                        const std::vector<std::shared_ptr<Miner>>& miners) = 0;
+protected:
+    // null unless write_profile was called
+    nlohmann::json profile;
+    // null unless write_perf_counters was called
+    nlohmann::json perf_counters;
+    // null unless write_peak_rss was called
+    nlohmann::json peak_rss_bytes;
+};
+
+// Writes the results as a single JSON document
+// Blocks come first in the document, so they are written as soon as they are found
+// With dictionary encoding, blocks have pool_id, miner_id and receiver_id keys which are
+// indexes in the pool_names and addresses arrays of the "dictionary" key following them,
+// as are the previous_pool_id and next_pool_id keys of the hop events of the miners
+class JSONResultWriter : public ResultWriter {
+public:
+    JSONResultWriter(const std::string& filepath, bool compact, uint8_t block_fields = BlockField::all,
+                     bool dictionary_encoding = false);
+
+    void write_block(const BlockEvent& block_event) override;
+
+    // Adds the dictionary as "output_dictionary"
+    void add_memory_usage(MemoryUsage& usage) const override;
+
+    void finish(int64_t runtime_milliseconds,
+                const std::vector<std::shared_ptr<MiningPool>>& pools,
+                const std::vector<std::shared_ptr<Miner>>& miners) override;
+private:
+    std::string filepath;
+    std::unique_ptr<std::ostream> output;
+    std::unique_ptr<JSONWriter> writer;
+    uint8_t block_fields;
+    std::unique_ptr<OutputDictionary> dictionary;
+};
+
+// Writes the results as newline-delimited JSON
+// Each block is written as soon as it is found, followed by one line per pool
+// and per miner and a summary line once the simulation is over
+// Every line has a "type" key set to "block", "hop", "snapshot", "pool", "miner" or "summary"
+// With dictionary encoding, events refer to pool names and addresses by ID, each
+// defined once by a "pool_name" or "address" line with "id" and "value" keys
+// written before the first line using it
+class NDJSONResultWriter : public ResultWriter {
+public:
+    explicit NDJSONResultWriter(const std::string& filepath, uint8_t block_fields = BlockField::all,
+                                bool dictionary_encoding = false);
+
+    void write_block(const BlockEvent& block_event) override;
+    void write_hop(const HopEvent& hop_event) override;
+    void write_snapshot(const PoolSnapshot& snapshot) override;
+
+    // Adds the dictionary as "output_dictionary"
+    void add_memory_usage(MemoryUsage& usage) const override;
+
+    void finish(int64_t runtime_milliseconds,
+                const std::vector<std::shared_ptr<MiningPool>>& pools,
+                const std::vector<std::shared_ptr<Miner>>& miners) override;
+private:
+    // Returns the ID of the pool name or address, writing its definition the first time
+    uint32_t encode(const std::string& pool_name);
+    uint32_t encode(Address address);
+
+    std::string filepath;
+    std::unique_ptr<std::ostream> output;
+    std::unique_ptr<JSONWriter> writer;
+    uint8_t block_fields;
+    std::unique_ptr<OutputDictionary> dictionary;
+};
+
+// Writes the results in the binary columnar format (see columnar.h)
+// Block columns are filled while the simulation runs and everything
+// is written once it is over, as are hops. Addresses and pool names are stored once,
+// in the "addresses" and "pools.name" columns, and referred to by ID.
+class ColumnarResultWriter : public ResultWriter {
+public:
+    explicit ColumnarResultWriter(const std::string& filepath, uint8_t block_fields = BlockField::all);
+
+    void write_block(const BlockEvent& block_event) override;
+    void write_hop(const HopEvent& hop_event) override;
+
+    // Adds the buffered block and hop columns as "output_columns",
+    // and the addresses and pool names as "output_dictionary"
+    void add_memory_usage(MemoryUsage& usage) const override;
+
+    void finish(int64_t runtime_milliseconds,
+                const std::vector<std::shared_ptr<MiningPool>>& pools,
+                const std::vector<std::shared_ptr<Miner>>& miners) override;
+private:
+    std::string filepath;
+    // blocks columns are only filled and written for these fields
+    uint8_t block_fields;
+    AddressDictionary addresses;
+    // pool names in the order in which they first appear in blocks and hops
+    PoolNameDictionary event_pool_names;
+
+    std::vector<double> block_times;
+    std::vector<uint8_t> block_uncles;
+    std::vector<uint32_t> block_pool_ids;
+    std::vector<uint32_t> block_miner_ids;
+    std::vector<uint8_t> block_data_types;
+    std::vector<uint64_t> block_shares;
+    std::vector<double> block_pool_luck;
+    std::vector<uint32_t> block_receiver_ids;
+    std::vector<uint64_t> block_credit_balances;
+    std::vector<uint64_t> block_reset_balances;
+    std::vector<double> block_prop_credits_lost;
+    std::vector<double> block_total_credits_lost;
+    std::vector<double> block_average_credits_lost;
+
+    std::vector<uint64_t> hop_times;
+    std::vector<uint32_t> hop_miner_ids;
+    std::vector<uint32_t> hop_previous_pool_ids;
+    std::vector<uint32_t> hop_next_pool_ids;
+};
+
+// Opens the file for writing, compressing it if its name ends with .gz
+std::unique_ptr<std::ostream> open_output_file(const std::string& filepath);
+
+}
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <stdexcept>
+
 #include <nlohmann/json.hpp>
 
 #include "mining_pool.h"
 #include "share.h"
 #include "factory.h"
+#include "memory_usage.h"
+#include "output_dictionary.h"
 
 namespace poolsim {
 
@@ -28,15 +32,31 @@ class ShareHandler {
 public:
     virtual ~ShareHandler();
 
-    // Miners delegates to this method to handle the share that it found
+    // Handlers bound to a miner handle the share it found in this method
+    // Flyweights have no miner and throw std::logic_error
     virtual void handle_share(const Share& share) = 0;
 
+    // Handles a share found by the given miner
+    // Handlers bound to a miner ignore the argument and delegate to handle_share(share)
+    virtual void handle_share(Miner& miner, const Share& share);
+
+    // Returns true if a single instance of the handler is shared by all the miners using it
+    // Such handlers are never bound to a miner and must not keep any state
+    virtual bool is_flyweight() const;
+
+    // Adds the estimated bytes held by the handler, nothing by default
+    virtual void add_memory_usage(MemoryUsage& usage) const;
+
     // Returns the name of the share handler
     virtual std::string get_name() const = 0;
 
     // Returns the metadata of the share handler (if any)
     virtual nlohmann::json get_json_metadata() = 0;
 
+    // Returns the metadata with pool names and addresses referred to by their ID in the dictionary
+    // Same as get_json_metadata by default, for handlers whose metadata has neither
+    virtual nlohmann::json get_encoded_json_metadata(OutputDictionary& dictionary);
+
     // Set the miner for this share handler
     // ShareHandler and Miner must be a 1 to 1 relationship
     void set_miner(std::shared_ptr<Miner> miner);
@@ -45,15 +65,19 @@ public:
     // Use this rather than accessing the weak_ptr property
     const std::shared_ptr<Miner> get_miner() const;
 
-    // Returns the network
+    // Returns the network of the miner
+    // This and the methods below throw std::logic_error if no miner is bound
     const std::shared_ptr<Network> get_network() const;
 
-    // Returns the pool
+    // Returns the pool of the miner
     std::shared_ptr<MiningPool> get_pool() const;
 
-    // Returns the address
-    std::string get_address() const;
+    // Returns the address of the miner
+    Address get_address() const;
 protected:
+    // Returns the miner of this handler, throws std::logic_error if there is none
+    const std::shared_ptr<Miner> get_bound_miner() const;
+
     std::weak_ptr<Miner> miner;
 
     // random instance
@@ -62,6 +86,11 @@ protected:
 
 MAKE_FACTORY(ShareHandlerFactory, ShareHandler, const nlohmann::json&)
 
+// Creates the share handler registered under the given name
+// Flyweight handlers are shared by every miner created with the same name and args
+// for as long as one of them holds the handler
+std::shared_ptr<ShareHandler> create_share_handler(const std::string& name, const nlohmann::json& args);
+
 class QBShareHandler : public ShareHandler {
 public:
     virtual void handle_share(const Share& share) = 0;
@@ -81,7 +110,7 @@ protected:
     // be submitted
     bool should_attack(std::vector<std::shared_ptr<QBRecord>>& records);
     // returns the address of the attack victim
-    std::string get_victim_address(std::vector<std::shared_ptr<QBRecord>>& records);
+    Address get_victim_address(std::vector<std::shared_ptr<QBRecord>>& records);
     // used to check if miner is in top N of the pool
     uint64_t top_n = 0;
     // used to check if credits of another miner are within a specified range
@@ -108,6 +137,29 @@ nlohmann::json BaseShareHandler<T>::get_json_metadata() {
 }
 
 
+// Base class for behaviors without any per-miner state
+// The miner is received as an argument instead of being stored in the handler
+template <typename T>
+class FlyweightShareHandler : public BaseShareHandler<T> {
+public:
+    using ShareHandler::handle_share;
+
+    // Throws std::logic_error, flyweights only handle shares given with their miner
+    void handle_share(const Share& share) override;
+
+    bool is_flyweight() const override;
+};
+
+template <typename T>
+void FlyweightShareHandler<T>::handle_share(const Share& share) {
+    throw std::logic_error(this->get_name() + " handler is a flyweight and needs the miner of the share");
+}
+
+template <typename T>
+bool FlyweightShareHandler<T>::is_flyweight() const {
+    return true;
+}
+
 template <typename T>
 class QBBaseShareHandler :
     public QBShareHandler,
@@ -115,28 +167,53 @@ class QBBaseShareHandler :
 };
   
 // Default implementation for ShareHandler
-class DefaultShareHandler: public BaseShareHandler<DefaultShareHandler> {
+class DefaultShareHandler: public FlyweightShareHandler<DefaultShareHandler> {
 public:
+    using FlyweightShareHandler::handle_share;
+
     explicit DefaultShareHandler(const nlohmann::json& args);
     // Simply submits the share to the mining pool
-    virtual void handle_share(const Share& share) override;
+    void handle_share(Miner& miner, const Share& share) override;
+
+    // Handles a share of the miner with the given pool and address
+    // RewardSchemeClass must be the exact type of the pool reward scheme
+    template <typename RewardSchemeClass>
+    void handle_share_with(MiningPool& pool, Address address, const Share& share);
 
     std::string get_name() const override;
 };
 
+template <typename RewardSchemeClass>
+void DefaultShareHandler::handle_share_with(MiningPool& pool, Address address, const Share& share) {
+    pool.submit_share<RewardSchemeClass>(address, share);
+}
+
 // IMPLEMENTED: YES
 // Behaviour: if the share is valid, the miner does not submit the share to the pool. This is 
 // a traditional block withholding attack.
 // Else, the share is submitted as specified by the default behaviour. 
-class WithholdingShareHandler : public BaseShareHandler<WithholdingShareHandler> {
+class WithholdingShareHandler : public FlyweightShareHandler<WithholdingShareHandler> {
 public:
+    using FlyweightShareHandler::handle_share;
+
     explicit WithholdingShareHandler(const nlohmann::json& args);
     // Withholds valid shares (including uncles) from submitting to pool operator
-    void handle_share(const Share& share) override;
+    void handle_share(Miner& miner, const Share& share) override;
+
+    // Handles a share of the miner with the given pool and address
+    // RewardSchemeClass must be the exact type of the pool reward scheme
+    template <typename RewardSchemeClass>
+    void handle_share_with(MiningPool& pool, Address address, const Share& share);
 
     std::string get_name() const override;
 };
 
+template <typename RewardSchemeClass>
+void WithholdingShareHandler::handle_share_with(MiningPool& pool, Address address, const Share& share) {
+    if (!share.is_valid_block())
+        pool.submit_share<RewardSchemeClass>(address, share);
+}
+
 // IMPLEMENTED: YES
 // Behaviour: miner checks if he is currently in the top N positions in the queue of the pool
 // and whether there is a miner with a credit balance of p% or less behind him. If this is true,
@@ -166,9 +243,23 @@ public:
     // Donates the share to a specified address if a defined condition is true
     void handle_share(const Share& share) override;
 
+    // Handles a share of the miner with the given pool and address
+    // RewardSchemeClass must be the exact type of the pool reward scheme
+    template <typename RewardSchemeClass>
+    void handle_share_with(MiningPool& pool, Address address, const Share& share);
+
     std::string get_name() const override;
+private:
+    // Returns the address the share of the miner should be submitted to
+    // and counts it as donated if it is not the miner's own address
+    Address get_receiver_address(Address address, const Share& share);
 };
 
+template <typename RewardSchemeClass>
+void DonationShareHandler::handle_share_with(MiningPool& pool, Address address, const Share& share) {
+    pool.submit_share<RewardSchemeClass>(get_receiver_address(address, share), share);
+}
+
 // IMPLEMENTED: YES
 // Behaviour: miner checks if he is currently in the top N positions in the queue of the pool
 // and whether there is a miner with a credit balance of p% or less behind him. If this is true,
@@ -186,9 +277,9 @@ public:
     std::string get_name() const override;
 private:
     // list of all addresses in pool controlled by miner
-    std::vector<std::string> addresses;
+    std::vector<Address> addresses;
     // returns an address owned by the miner at random from the list of addresses
-    std::string get_random_address() const;
+    Address get_random_address() const;
 };
 
 
@@ -196,6 +287,7 @@ struct HopEvent {
     std::string previous_pool;
     std::string next_pool;
     uint64_t time;
+    Address miner_address;
 };
 
 // IMPLEMENTED: YES
@@ -207,6 +299,10 @@ public:
     void handle_share(const Share& share) override;
 
     nlohmann::json get_json_metadata() override;
+    nlohmann::json get_encoded_json_metadata(OutputDictionary& dictionary) override;
+
+    // Adds the bytes of the hop events as "hop_events"
+    void add_memory_usage(MemoryUsage& usage) const override;
 protected:
     virtual std::shared_ptr<MiningPool> get_hop_target() = 0;
     virtual bool should_hop() = 0;
@@ -5,6 +5,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include "block_event.h"
+
 namespace poolsim {
 
 class InvalidSimulationException : public std::exception {
@@ -42,6 +44,24 @@ struct PoolConfig {
     std::vector<MinerConfig> miners_config;
 };
 
+// What is written to the results, and thus collected during the simulation
+struct OutputConfig {
+    // Writes the blocks found, otherwise only the final state of pools and miners
+    bool blocks = true;
+
+    // Fields written for each block, as a combination of BlockField
+    uint8_t block_fields = BlockField::all;
+
+    // Writes one block out of block_interval
+    uint64_t block_interval = 1;
+
+    // Records the hops of pool hopping miners
+    bool hop_events = true;
+
+    // Refers to pool names and addresses by ID in JSON and NDJSON events
+    bool dictionary_encoding = false;
+};
+
 struct Simulation {
     // Creates a Simulation from a config file
     static Simulation from_config_file(const std::string& filepath);
@@ -64,9 +84,22 @@ struct Simulation {
 
     // Random seed to use for the simulation
     long seed = 0;
+
+    // Writes JSON results without indentation
+    bool compact_output = false;
+
+    // Formats and writes results on a background thread
+    bool async_output = true;
+
+    // Number of blocks between two snapshots of the pools, 0 to disable them
+    uint64_t snapshot_interval = 0;
+
+    // Level of detail of the results
+    OutputConfig output_config;
 };
 
 void from_json(const nlohmann::json& j, Simulation& simulation);
+void from_json(const nlohmann::json& j, OutputConfig& output_config);
 void from_json(const nlohmann::json& j, PoolConfig& pool_config);
 void from_json(const nlohmann::json& j, MinerConfig& miner_config);
 void from_json(const nlohmann::json& j, RewardSchemeConfig& reward_scheme_config);
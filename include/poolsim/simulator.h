@@ -1,8 +1,9 @@
 #pragma once
 
+#include <fstream>
 #include <string>
 #include <vector>
-#include <map>
+#include <typeinfo>
 
 #include "miner.h"
 #include "mining_pool.h"
@@ -14,11 +15,20 @@
 #include "miner_creator.h"
 #include "observer.h"
 #include "block_event.h"
+#include "result_writer.h"
+#include "share_handler.h"
+#include "perf_counters.h"
+#include "progress.h"
+#include "memory_usage.h"
 
 namespace poolsim {
 
+// memory reports written during a simulation, besides the final one
+const uint64_t default_memory_checkpoints = 10;
+
 class Simulator :  public std::enable_shared_from_this<Simulator>,
-                   public Observer<BlockEvent> {
+                   public Observer<BlockEvent>,
+                   public Observer<HopEvent> {
 public:
     explicit Simulator(Simulation simulation);
     Simulator(Simulation simulation, std::shared_ptr<Random> random);
@@ -28,12 +38,38 @@ public:
     void run();
 
     // Initializes the simulator
-    // creates pools and miners
+    // creates pools and miners and selects the event loop to run
     void initialize();
 
+    // Returns true if the event loop is specialized for the reward scheme
+    // and share handler used by the simulation
+    bool is_specialized() const;
+
+    // Makes initialize select the generic event loop even when a specialized
+    // one exists, e.g. to check that both give the same results
+    void disable_specialization();
+
     // Saves the simulation data to a file
     void save_simulation_data();
 
+    // Counts hardware events (cycles, cache misses...) during the event loop
+    // and adds them to the results, as far as the kernel allows it
+    void enable_perf_counters();
+
+    // Reports the progress of the event loop every interval seconds of wall time
+    // to destination, see ProgressReporter
+    void enable_progress_reports(const std::string& destination,
+                                 double interval_seconds = default_progress_interval);
+
+    // Reports the RSS and the estimated bytes of each structure as JSON lines to
+    // destination ("-" for stderr) at checkpoints evenly spread over the blocks
+    // of the simulation, and once more after saving the results
+    void enable_memory_reports(const std::string& destination,
+                               uint64_t checkpoints = default_memory_checkpoints);
+
+    // Returns the estimated bytes held by each structure of the simulation
+    MemoryUsage get_memory_usage() const;
+
     // Schedules all the miners
     // This should only be used for the first initialization
     void schedule_all();
@@ -45,14 +81,17 @@ public:
     // Schedules a single miner
     void schedule_miner(const std::shared_ptr<Miner> miner);
 
+    // Schedules the miner with the given ID from its cached constants
+    void schedule_miner(uint32_t miner_id, const SchedulingEntry& scheduling);
+
     // Adds a miner to the simulator
     void add_miner(std::shared_ptr<Miner> miner);
 
     // Adds a pool to the simulator
     void add_pool(std::shared_ptr<MiningPool> pool);
 
-    // Returns the miner with the given address:
-    std::shared_ptr<Miner> get_miner(const std::string& miner_address);
+    // Returns the miner with the given ID
+    std::shared_ptr<Miner> get_miner(uint32_t miner_id);
 
     // Returns the numbers of pool
     size_t get_pools_count() const;
@@ -69,14 +108,59 @@ public:
     // Returns the next event
     Event get_next_event() const;
 
+    // Removes the next event from the queue and returns it
+    Event pop_next_event();
+
+    // Changes the network difficulty and refreshes
+    // the scheduling constants of every miner
+    void set_network_difficulty(uint64_t difficulty);
+
     void process(const BlockEvent& block_event);
 
+    void process(const HopEvent& hop_event);
+
 private:
+    // Event loop of the simulator
+    typedef void (Simulator::*Kernel)();
+
+    // Runs events until the target number of blocks is reached
+    void run_events();
+
+    // Same as run_events, but with the reward scheme and share handler
+    // of every pool and miner known at compile time
+    template <typename RewardSchemeClass, typename ShareHandlerClass>
+    void run_specialized_events();
+
+    // Returns a specialized event loop if all the pools use the same built-in
+    // reward scheme and all the miners the same built-in share handler,
+    // and the generic one otherwise
+    Kernel select_kernel() const;
+
+    // Returns the event loop specialized for the given share handler
+    template <typename RewardSchemeClass>
+    static Kernel select_kernel(const std::type_info& handler_type);
+
+    // Moves the network to the time of the event, draws the share
+    // found by the miner and schedules its next event
+    Share draw_share(const Event& event);
+
+    // Returns the writer for the simulation output, creating it on first use
+    ResultWriter& get_result_writer();
+
+    // Writes the current state of every pool
+    void write_snapshots();
+
+    // Reports the progress of the event loop if a report is due, or if done
+    void report_progress(bool done);
+
+    // Writes a memory report line
+    void report_memory(bool done);
+
     // Setup of the simulation to run
     Simulation simulation;
 
-    // List of block events
-    std::vector<BlockEvent> block_events;
+    // Destination of the results, created when the simulation starts
+    std::unique_ptr<ResultWriter> result_writer;
 
     // Information about the network
     std::shared_ptr<Network> network;
@@ -91,14 +175,42 @@ private:
     // Pools in the current simulation
     std::vector<std::shared_ptr<MiningPool>> pools;
 
-    // Miners in the current simulation
-    std::map<std::string, std::shared_ptr<Miner>> miners;
+    // Miners in the current simulation, indexed by ID
+    std::vector<std::shared_ptr<Miner>> miners;
+
+    // Hot state of the miners, indexed by ID
+    MinerTable miner_table;
+
+    // Event loop used by run
+    Kernel kernel;
+
+    // Whether initialize may select a specialized event loop
+    bool specialization_enabled = true;
 
     // Duration of the simulation
     int64_t duration;
 
-    // Outputs the result to a file
-    void output_result(const nlohmann::json& result) const;
+    // Events processed since the simulation started
+    uint64_t events_count = 0;
+
+    // Destination and interval of the progress reports, reported by
+    // progress_reporter while run is running
+    std::string progress_destination;
+    double progress_interval = default_progress_interval;
+    std::unique_ptr<ProgressReporter> progress_reporter;
+
+    // Destination of the memory reports, and blocks between two of them
+    std::string memory_report_destination;
+    uint64_t memory_checkpoints = 0;
+    uint64_t memory_report_interval = 0;
+    std::unique_ptr<std::ofstream> memory_report_file;
+
+    // Whether run counts hardware events, and the events it counted
+    bool perf_counters_enabled = false;
+    PerfCounts perf_counts;
+
+    // Number of block events received, to write one out of block_interval
+    uint64_t block_events_count = 0;
 };
 
 }
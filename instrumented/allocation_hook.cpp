@@ -0,0 +1,49 @@
+#include <cstdlib>
+#include <new>
+
+#include "allocation_tracker.h"
+
+// Replacements of the global operator new and delete reporting every
+// allocation to the AllocationTracker
+// Only linked into poolsim-instrumented and the benchmarks, never into libpoolsim
+
+static void* allocate(size_t size) {
+    poolsim::AllocationTracker::get_instance().record_allocation(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size) {
+    void* ptr = allocate(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
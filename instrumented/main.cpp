@@ -0,0 +1,19 @@
+#include <iostream>
+
+#include "allocation_tracker.h"
+#include "cli.h"
+#include "profiler.h"
+
+// poolsim with every allocation counted, the report is printed to stderr
+// Allocations per share are the allocations of the run stage divided by the shares processed
+int main(int argc, char* argv[]) {
+    poolsim::AllocationTracker& tracker = poolsim::AllocationTracker::get_instance();
+    tracker.start();
+
+    int status = poolsim::run(argc, argv);
+
+    const poolsim::Profiler& profiler = poolsim::Profiler::get_instance();
+    uint64_t shares = profiler.get_phase(poolsim::ProfilePhase::share_handler).calls;
+    std::cerr << poolsim::get_allocation_report(tracker, shares).dump(2) << std::endl;
+    return status;
+}
@@ -0,0 +1,229 @@
+#include "address.h"
+#include "memory_usage.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace poolsim {
+
+namespace {
+
+const char hex_chars[] = "0123456789abcdef";
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+size_t hash_bytes(const AddressBytes& bytes) {
+    uint64_t prefix;
+    std::memcpy(&prefix, bytes.data(), sizeof(prefix));
+    return static_cast<size_t>(prefix * 0x9e3779b97f4a7c15ULL);
+}
+
+const AddressBytes null_bytes = {};
+
+}
+
+AddressTable& AddressTable::get_instance() {
+    static AddressTable instance;
+    return instance;
+}
+
+bool AddressTable::parse(const std::string& address, AddressBytes& bytes) {
+    if (address.size() != 2 + 2 * bytes.size() || address[0] != '0' || address[1] != 'x') {
+        return false;
+    }
+    for (size_t i = 0; i < bytes.size(); i++) {
+        int high = hex_value(address[2 + 2 * i]);
+        int low = hex_value(address[3 + 2 * i]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        bytes[i] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return true;
+}
+
+uint32_t AddressTable::intern(const std::string& address) {
+    AddressBytes bytes;
+    if (parse(address, bytes)) {
+        return intern(bytes);
+    }
+
+    auto it = label_ids.find(address);
+    if (it != label_ids.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(addresses.size());
+    addresses.push_back(null_bytes);
+    label_ids[address] = id;
+    labels[id] = address;
+    return id;
+}
+
+uint32_t AddressTable::intern(const AddressBytes& bytes) {
+    if (!index.empty()) {
+        size_t mask = index.size() - 1;
+        for (size_t slot = hash_bytes(bytes) & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+            uint32_t id = index[slot] - 1;
+            if (addresses[id] == bytes) {
+                return id;
+            }
+        }
+    }
+
+    uint32_t id = static_cast<uint32_t>(addresses.size());
+    addresses.push_back(bytes);
+    insert_index(id);
+    return id;
+}
+
+void AddressTable::insert_index(uint32_t id) {
+    // keep the load factor under 1/2
+    if (2 * (addresses.size() - labels.size()) > index.size()) {
+        grow_index();
+        return;
+    }
+    size_t mask = index.size() - 1;
+    size_t slot = hash_bytes(addresses[id]) & mask;
+    while (index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    index[slot] = id + 1;
+}
+
+void AddressTable::grow_index() {
+    index.assign(index.empty() ? 1024 : 2 * index.size(), 0);
+    size_t mask = index.size() - 1;
+    for (uint32_t id = 0; id < addresses.size(); id++) {
+        if (labels.find(id) != labels.end()) {
+            continue;
+        }
+        size_t slot = hash_bytes(addresses[id]) & mask;
+        while (index[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = id + 1;
+    }
+}
+
+std::string AddressTable::to_string(uint32_t id) const {
+    auto it = labels.find(id);
+    if (it != labels.end()) {
+        return it->second;
+    }
+    const AddressBytes& bytes = addresses[id];
+    std::string result(2 + 2 * bytes.size(), '0');
+    result[1] = 'x';
+    for (size_t i = 0; i < bytes.size(); i++) {
+        result[2 + 2 * i] = hex_chars[bytes[i] >> 4];
+        result[3 + 2 * i] = hex_chars[bytes[i] & 0xf];
+    }
+    return result;
+}
+
+const AddressBytes& AddressTable::get_bytes(uint32_t id) const {
+    return addresses[id];
+}
+
+bool AddressTable::less(uint32_t lhs, uint32_t rhs) const {
+    bool lhs_label = labels.find(lhs) != labels.end();
+    bool rhs_label = labels.find(rhs) != labels.end();
+    if (!lhs_label && !rhs_label) {
+        // lowercase hex digits sort like the bytes they encode
+        return addresses[lhs] < addresses[rhs];
+    }
+    return to_string(lhs) < to_string(rhs);
+}
+
+size_t AddressTable::size() const {
+    return addresses.size();
+}
+
+uint64_t AddressTable::get_memory_usage() const {
+    uint64_t bytes = poolsim::get_memory_usage(addresses) + poolsim::get_memory_usage(index);
+    // labels are stored twice, in nodes holding the pair and the next node
+    for (const auto& label : labels) {
+        bytes += 2 * (sizeof(std::string) + sizeof(uint32_t) + sizeof(void*) +
+                      poolsim::get_memory_usage(label.second));
+    }
+    bytes += (label_ids.bucket_count() + labels.bucket_count()) * sizeof(void*);
+    return bytes;
+}
+
+
+Address::Address() : id(null_id) {}
+
+Address::Address(const std::string& address)
+    : id(AddressTable::get_instance().intern(address)) {}
+
+Address::Address(const char* address) : Address(std::string(address)) {}
+
+Address::Address(const AddressBytes& bytes)
+    : id(AddressTable::get_instance().intern(bytes)) {}
+
+Address Address::from_id(uint32_t id) {
+    Address address;
+    address.id = id;
+    return address;
+}
+
+const AddressBytes& Address::get_bytes() const {
+    if (is_null()) {
+        return null_bytes;
+    }
+    return AddressTable::get_instance().get_bytes(id);
+}
+
+std::string Address::to_string() const {
+    if (is_null()) {
+        return "";
+    }
+    return AddressTable::get_instance().to_string(id);
+}
+
+bool operator<(const Address& lhs, const Address& rhs) {
+    if (lhs.is_null() || rhs.is_null()) {
+        return lhs.is_null() && !rhs.is_null();
+    }
+    return AddressTable::get_instance().less(lhs.get_id(), rhs.get_id());
+}
+
+std::ostream& operator<<(std::ostream& os, const Address& address) {
+    return os << address.to_string();
+}
+
+void to_json(nlohmann::json& j, const Address& address) {
+    j = address.to_string();
+}
+
+uint32_t AddressDictionary::get_id(Address address) {
+    if (address.is_null()) {
+        return Address::null_id;
+    }
+    uint32_t table_id = address.get_id();
+    if (table_id >= ids.size()) {
+        ids.resize(std::max<size_t>(table_id + 1, ids.size() * 2), 0);
+    }
+    if (ids[table_id] == 0) {
+        addresses.push_back(address);
+        ids[table_id] = static_cast<uint32_t>(addresses.size());
+    }
+    return ids[table_id] - 1;
+}
+
+const std::vector<Address>& AddressDictionary::get_addresses() const {
+    return addresses;
+}
+
+uint64_t AddressDictionary::get_memory_usage() const {
+    return poolsim::get_memory_usage(ids) + poolsim::get_memory_usage(addresses);
+}
+
+}
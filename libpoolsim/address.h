@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdint>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+namespace poolsim {
+
+// Binary representation of an address (20 bytes)
+using AddressBytes = std::array<uint8_t, 20>;
+
+// Global table storing every address used in the simulation exactly once
+// Addresses in the canonical format (0x prefix + 40 lowercase hex chars)
+// are stored as 20 bytes and only converted back to hex for the output.
+// Any other string (e.g. names in a CSV file) is kept as is.
+// The table is shared by the whole process and never shrinks, so running
+// several simulations in a process (tests, benchmarks) keeps the addresses
+// of all of them, which the memory report counts under "addresses"
+class AddressTable {
+public:
+    static AddressTable& get_instance();
+
+    // Returns the ID of the given address, adding it to the table if needed
+    uint32_t intern(const std::string& address);
+    uint32_t intern(const AddressBytes& bytes);
+
+    // Returns the string representation of the address with the given ID
+    std::string to_string(uint32_t id) const;
+
+    // Returns the binary representation of the address with the given ID
+    // This is all zeros for addresses which are not in the canonical format
+    const AddressBytes& get_bytes(uint32_t id) const;
+
+    // Returns true if the address with the first ID comes before the second one
+    // in the order of their string representations
+    bool less(uint32_t lhs, uint32_t rhs) const;
+
+    // Returns the number of addresses in the table
+    size_t size() const;
+
+    // Returns the estimated bytes held by the table
+    uint64_t get_memory_usage() const;
+
+    // Parses a canonical address, returns false if the string is not one
+    static bool parse(const std::string& address, AddressBytes& bytes);
+
+    // Avoid accidental copies
+    AddressTable(AddressTable const&) = delete;
+    void operator=(AddressTable const&) = delete;
+private:
+    AddressTable() = default;
+
+    // Inserts the ID in the open addressing index
+    void insert_index(uint32_t id);
+    // Doubles the size of the index
+    void grow_index();
+
+    // binary addresses, indexed by ID
+    std::vector<AddressBytes> addresses;
+    // open addressing index of the canonical addresses, storing ID + 1
+    std::vector<uint32_t> index;
+    // addresses which are not in the canonical format
+    std::unordered_map<std::string, uint32_t> label_ids;
+    std::unordered_map<uint32_t, std::string> labels;
+};
+
+// Handle to an address interned in the AddressTable
+// Copying and comparing an address only copies and compares its ID
+class Address {
+public:
+    // Creates a null address
+    Address();
+    Address(const std::string& address);
+    Address(const char* address);
+    explicit Address(const AddressBytes& bytes);
+
+    // Returns the address with the given ID in the table
+    static Address from_id(uint32_t id);
+
+    // Returns the ID of the address in the table
+    inline uint32_t get_id() const { return id; }
+
+    // Returns true if this is the null address
+    inline bool is_null() const { return id == null_id; }
+
+    // Returns the binary representation of the address
+    const AddressBytes& get_bytes() const;
+
+    // Returns the string representation of the address
+    // The null address is represented as an empty string
+    std::string to_string() const;
+
+    static const uint32_t null_id = UINT32_MAX;
+private:
+    uint32_t id;
+};
+
+inline bool operator==(const Address& lhs, const Address& rhs) { return lhs.get_id() == rhs.get_id(); }
+inline bool operator!=(const Address& lhs, const Address& rhs) { return lhs.get_id() != rhs.get_id(); }
+// Orders addresses as their string representations, the null address first
+bool operator<(const Address& lhs, const Address& rhs);
+
+std::ostream& operator<<(std::ostream& os, const Address& address);
+
+// Assigns dense IDs to addresses in the order in which they are first seen
+// Used to write each address of the output only once
+class AddressDictionary {
+public:
+    // Returns the ID of the address in the dictionary, adding it if needed
+    // The null address is not added and gets Address::null_id
+    uint32_t get_id(Address address);
+
+    // Returns the addresses of the dictionary, indexed by ID
+    const std::vector<Address>& get_addresses() const;
+
+    // Returns the bytes held by the IDs and the addresses
+    uint64_t get_memory_usage() const;
+private:
+    // dictionary ID + 1, indexed by address table ID
+    std::vector<uint32_t> ids;
+    std::vector<Address> addresses;
+};
+
+void to_json(nlohmann::json& j, const Address& address);
+
+}
+
+namespace std {
+
+template <>
+struct hash<poolsim::Address> {
+    size_t operator()(const poolsim::Address& address) const {
+        return hash<uint32_t>()(address.get_id());
+    }
+};
+
+}
@@ -0,0 +1,132 @@
+#include "allocation_tracker.h"
+
+namespace poolsim {
+
+AllocationTracker AllocationTracker::instance;
+
+// only the thread which called start is attributed to stages and phases
+static thread_local bool tracked_thread = false;
+
+const char* get_stage_name(SimulationStage stage) {
+    switch (stage) {
+    case SimulationStage::initialize: return "initialize";
+    case SimulationStage::run: return "run";
+    case SimulationStage::save: return "save";
+    }
+    return "unknown";
+}
+
+AllocationTracker& AllocationTracker::get_instance() {
+    return instance;
+}
+
+void AllocationTracker::start() {
+    for (AllocationCount& count : stages) {
+        count = AllocationCount();
+    }
+    for (AllocationCount& count : phases) {
+        count = AllocationCount();
+    }
+    unprofiled = AllocationCount();
+    other_threads_count = 0;
+    other_threads_bytes = 0;
+    stage = SimulationStage::initialize;
+    tracked_thread = true;
+}
+
+static void add_allocation(AllocationCount& count, size_t size) {
+    count.count++;
+    count.bytes += size;
+}
+
+void AllocationTracker::record_allocation(size_t size) {
+    if (!tracked_thread) {
+        other_threads_count.fetch_add(1, std::memory_order_relaxed);
+        other_threads_bytes.fetch_add(size, std::memory_order_relaxed);
+        return;
+    }
+    add_allocation(stages[static_cast<size_t>(stage)], size);
+    const ProfileScope* scope = Profiler::get_instance().get_current();
+    if (scope == nullptr) {
+        add_allocation(unprofiled, size);
+    } else {
+        add_allocation(phases[static_cast<size_t>(scope->get_phase())], size);
+    }
+}
+
+void AllocationTracker::set_stage(SimulationStage _stage) {
+    stage = _stage;
+}
+
+AllocationCount AllocationTracker::get_total() const {
+    AllocationCount total;
+    for (const AllocationCount& count : stages) {
+        total.count += count.count;
+        total.bytes += count.bytes;
+    }
+    return total;
+}
+
+AllocationCount AllocationTracker::get_stage(SimulationStage _stage) const {
+    return stages[static_cast<size_t>(_stage)];
+}
+
+AllocationCount AllocationTracker::get_phase(ProfilePhase phase) const {
+    return phases[static_cast<size_t>(phase)];
+}
+
+AllocationCount AllocationTracker::get_unprofiled() const {
+    return unprofiled;
+}
+
+AllocationCount AllocationTracker::get_other_threads() const {
+    AllocationCount count;
+    count.count = other_threads_count.load(std::memory_order_relaxed);
+    count.bytes = other_threads_bytes.load(std::memory_order_relaxed);
+    return count;
+}
+
+static nlohmann::json count_to_json(const AllocationCount& count) {
+    return {{"count", count.count}, {"bytes", count.bytes}};
+}
+
+nlohmann::json get_allocation_report(const AllocationTracker& tracker, uint64_t shares) {
+    // read everything first, building the report allocates on the tracked thread
+    AllocationCount total = tracker.get_total();
+    AllocationCount stages[simulation_stages_count];
+    for (size_t i = 0; i < simulation_stages_count; i++) {
+        stages[i] = tracker.get_stage(static_cast<SimulationStage>(i));
+    }
+    AllocationCount phases[profile_phases_count];
+    for (size_t i = 0; i < profile_phases_count; i++) {
+        phases[i] = tracker.get_phase(static_cast<ProfilePhase>(i));
+    }
+    AllocationCount unprofiled = tracker.get_unprofiled();
+    AllocationCount other_threads = tracker.get_other_threads();
+
+    nlohmann::json report = {
+        {"total", count_to_json(total)},
+        {"other_threads", count_to_json(other_threads)},
+        {"shares", shares}
+    };
+    for (size_t i = 0; i < simulation_stages_count; i++) {
+        report["stages"][get_stage_name(static_cast<SimulationStage>(i))] = count_to_json(stages[i]);
+    }
+    for (size_t i = 0; i < profile_phases_count; i++) {
+        report["phases"][get_phase_name(static_cast<ProfilePhase>(i))] = count_to_json(phases[i]);
+    }
+    report["phases"]["none"] = count_to_json(unprofiled);
+
+    // the run stage is the steady state, everything else is setup and teardown
+    const AllocationCount& run = stages[static_cast<size_t>(SimulationStage::run)];
+    if (shares > 0) {
+        report["allocations_per_share"] = static_cast<double>(run.count) / shares;
+        report["bytes_per_share"] = static_cast<double>(run.bytes) / shares;
+    } else {
+        report["allocations_per_share"] = nullptr;
+        report["bytes_per_share"] = nullptr;
+    }
+    return report;
+}
+
+}
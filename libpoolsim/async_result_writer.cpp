@@ -0,0 +1,201 @@
+#include <chrono>
+#include <stdexcept>
+
+#include "async_result_writer.h"
+#include "tracer.h"
+
+namespace poolsim {
+
+// number of empty polls of the queue before the writer thread starts sleeping
+static const int async_output_spins = 64;
+
+AsyncResultWriter::AsyncResultWriter(std::unique_ptr<ResultWriter> _writer, size_t capacity)
+    : writer(std::move(_writer)), queue(capacity), stopping(false), failed(false) {
+    thread = std::thread(&AsyncResultWriter::run, this);
+}
+
+AsyncResultWriter::~AsyncResultWriter() {
+    stop();
+}
+
+void AsyncResultWriter::write_block(const BlockEvent& block_event) {
+    OutputRecord record;
+    record.type = OutputRecord::Type::block;
+    record.is_uncle = block_event.is_uncle;
+    record.has_data = block_event.reward_scheme_data != nullptr;
+    record.data_type = block_event.reward_scheme_data_type;
+    record.miner_address = block_event.miner_address;
+    record.time = block_event.time;
+    record.pool_name = intern_pool_name(*block_event.pool_name);
+    if (record.has_data && record.data_type == BlockDataType::qb) {
+        record.data = static_cast<const QBBlockMetaData&>(*block_event.reward_scheme_data);
+    } else if (record.has_data) {
+        static_cast<BlockMetaData&>(record.data) = *block_event.reward_scheme_data;
+    }
+    push(record);
+}
+
+void AsyncResultWriter::write_hop(const HopEvent& hop_event) {
+    OutputRecord record;
+    record.type = OutputRecord::Type::hop;
+    record.miner_address = hop_event.miner_address;
+    record.time = hop_event.time;
+    record.pool_name = intern_pool_name(hop_event.previous_pool);
+    record.next_pool_name = intern_pool_name(hop_event.next_pool);
+    push(record);
+}
+
+void AsyncResultWriter::write_snapshot(const PoolSnapshot& snapshot) {
+    OutputRecord record;
+    record.type = OutputRecord::Type::snapshot;
+    record.time = snapshot.time;
+    record.pool_name = intern_pool_name(snapshot.pool_name);
+    record.block = snapshot.block;
+    record.blocks_mined = snapshot.blocks_mined;
+    record.miners_count = snapshot.miners_count;
+    record.luck = snapshot.luck;
+    push(record);
+}
+
+void AsyncResultWriter::write_profile(const Profiler& profiler) {
+    stop();
+    writer->write_profile(profiler);
+}
+
+void AsyncResultWriter::add_memory_usage(MemoryUsage& usage) const {
+    usage["output_queue"] += queue.capacity() * sizeof(OutputRecord);
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    writer->add_memory_usage(usage);
+}
+
+void AsyncResultWriter::write_perf_counters(const PerfCounts& counts) {
+    stop();
+    writer->write_perf_counters(counts);
+}
+
+void AsyncResultWriter::write_peak_rss(uint64_t bytes) {
+    stop();
+    writer->write_peak_rss(bytes);
+}
+
+void AsyncResultWriter::finish(int64_t runtime_milliseconds,
+                               const std::vector<std::shared_ptr<MiningPool>>& pools,
+                               const std::vector<std::shared_ptr<Miner>>& miners) {
+    stop();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    writer->finish(runtime_milliseconds, pools, miners);
+}
+
+void AsyncResultWriter::push(const OutputRecord& record) {
+    if (!thread.joinable()) {
+        throw std::logic_error("results cannot be written once the output thread is stopped");
+    }
+    check_error();
+    while (!queue.try_push(record)) {
+        check_error();
+        std::this_thread::yield();
+    }
+}
+
+void AsyncResultWriter::check_error() const {
+    if (failed.load(std::memory_order_acquire)) {
+        std::rethrow_exception(error);
+    }
+}
+
+const std::string* AsyncResultWriter::intern_pool_name(const std::string& name) {
+    // simulations have few pools, most recent first as blocks of a pool tend to follow each other
+    for (auto it = pool_names.rbegin(); it != pool_names.rend(); ++it) {
+        if (*it == name) {
+            return &*it;
+        }
+    }
+    pool_names.push_back(name);
+    return &pool_names.back();
+}
+
+void AsyncResultWriter::stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    stopping.store(true, std::memory_order_release);
+    thread.join();
+}
+
+void AsyncResultWriter::run() {
+    Tracer::get_instance().set_thread_name("output");
+    OutputRecord record;
+    int empty_polls = 0;
+    while (true) {
+        if (queue.try_pop(record)) {
+            write_record(record);
+            empty_polls = 0;
+            continue;
+        }
+        if (stopping.load(std::memory_order_acquire)) {
+            // records pushed before stopping was set are all visible now
+            while (queue.try_pop(record)) {
+                write_record(record);
+            }
+            return;
+        }
+        if (++empty_polls < async_output_spins) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+void AsyncResultWriter::write_record(const OutputRecord& record) {
+    // records are still consumed after an error, so that the simulation never blocks
+    if (error) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    try {
+        switch (record.type) {
+        case OutputRecord::Type::block: {
+            BlockEvent block_event {
+                .time = record.time,
+                .is_uncle = record.is_uncle,
+                .pool_name = record.pool_name,
+                .miner_address = record.miner_address,
+                .reward_scheme_data_type = record.data_type,
+                .reward_scheme_data = record.has_data ? &record.data : nullptr
+            };
+            writer->write_block(block_event);
+            break;
+        }
+        case OutputRecord::Type::hop: {
+            HopEvent hop_event {
+                .previous_pool = *record.pool_name,
+                .next_pool = *record.next_pool_name,
+                .time = static_cast<uint64_t>(record.time),
+                .miner_address = record.miner_address
+            };
+            writer->write_hop(hop_event);
+            break;
+        }
+        case OutputRecord::Type::snapshot: {
+            PoolSnapshot snapshot {
+                .time = record.time,
+                .block = record.block,
+                .pool_name = *record.pool_name,
+                .blocks_mined = record.blocks_mined,
+                .miners_count = record.miners_count,
+                .luck = record.luck
+            };
+            writer->write_snapshot(snapshot);
+            break;
+        }
+        }
+    } catch (...) {
+        error = std::current_exception();
+        failed.store(true, std::memory_order_release);
+    }
+}
+
+}
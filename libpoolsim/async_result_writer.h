@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <cstdint>
+
+#include "result_writer.h"
+#include "spsc_queue.h"
+
+namespace poolsim {
+
+// number of records the simulation can be ahead of the writer thread
+const size_t async_output_capacity = 1 << 12;
+
+// Fixed-size copy of a block, hop or snapshot
+// passed from the simulation thread to the writer thread
+struct OutputRecord {
+    enum class Type : uint8_t {
+        block,
+        hop,
+        snapshot
+    };
+
+    Type type;
+    bool is_uncle;
+    bool has_data;
+    BlockDataType data_type;
+    Address miner_address;
+    double time;
+    // pool of blocks and snapshots, previous pool of hops
+    const std::string* pool_name;
+    // next pool of hops
+    const std::string* next_pool_name;
+
+    // reward scheme data of blocks
+    QBBlockMetaData data;
+
+    // state of the pool for snapshots
+    uint64_t block;
+    uint64_t blocks_mined;
+    uint64_t miners_count;
+    double luck;
+};
+
+// Writes results from a separate thread
+// Events are copied into a bounded lock-free queue and written by another
+// writer on a background thread, so that formatting and I/O overlap with
+// the simulation. The simulation waits when the writer thread falls behind.
+// An error of the writer thread is thrown by the next write, so that a run
+// does not go on once its results cannot be written.
+class AsyncResultWriter : public ResultWriter {
+public:
+    explicit AsyncResultWriter(std::unique_ptr<ResultWriter> writer,
+                               size_t capacity = async_output_capacity);
+    ~AsyncResultWriter();
+
+    void write_block(const BlockEvent& block_event) override;
+    void write_hop(const HopEvent& hop_event) override;
+    void write_snapshot(const PoolSnapshot& snapshot) override;
+    // Waits for the queued records to be written before passing the profile on
+    // Only finish can be called afterwards, other writes throw std::logic_error
+    void write_profile(const Profiler& profiler) override;
+
+    // Same as write_profile for the hardware events and the peak RSS
+    void write_perf_counters(const PerfCounts& counts) override;
+    void write_peak_rss(uint64_t bytes) override;
+
+    // Adds the slots of the queue as "output_queue", and what the writer holds
+    // once the writer thread is done with its current record
+    void add_memory_usage(MemoryUsage& usage) const override;
+
+    // Waits for the queued records to be written, then finishes on the calling thread
+    // Throws if writing a record failed
+    void finish(int64_t runtime_milliseconds,
+                const std::vector<std::shared_ptr<MiningPool>>& pools,
+                const std::vector<std::shared_ptr<Miner>>& miners) override;
+private:
+    // Pushes a record, waiting while the queue is full
+    // Throws the error of the writer thread if there was one, and
+    // std::logic_error if the writer thread was stopped
+    void push(const OutputRecord& record);
+    // Throws the error of the writer thread if there was one
+    void check_error() const;
+    // Returns a copy of the pool name which stays valid until the writer is destroyed
+    const std::string* intern_pool_name(const std::string& name);
+    // Waits for the writer thread to write all the queued records
+    void stop();
+
+    void run();
+    void write_record(const OutputRecord& record);
+
+    std::unique_ptr<ResultWriter> writer;
+    SPSCQueue<OutputRecord> queue;
+    // only modified by the simulation thread, elements are never moved
+    std::deque<std::string> pool_names;
+
+    std::thread thread;
+    // held by the writer thread while it writes a record, so that the writer can be measured
+    mutable std::mutex writer_mutex;
+    std::atomic<bool> stopping;
+    // first error raised by the writer thread, set before failed
+    std::exception_ptr error;
+    std::atomic<bool> failed;
+};
+
+}
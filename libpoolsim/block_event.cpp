@@ -1,15 +1,126 @@
+#include <stdexcept>
+
 #include "block_event.h"
 
 namespace poolsim {
 
+uint8_t BlockField::from_name(const std::string& name) {
+    if (name == "time") {
+        return time;
+    } else if (name == "is_uncle") {
+        return is_uncle;
+    } else if (name == "pool_name") {
+        return pool_name;
+    } else if (name == "miner_address") {
+        return miner_address;
+    } else if (name == "reward_scheme_data") {
+        return reward_scheme_data;
+    }
+    throw std::invalid_argument("unknown block field " + name);
+}
+
 void to_json(nlohmann::json& j, const BlockEvent& data) {
+    nlohmann::json reward_scheme_data;
+    if (data.reward_scheme_data != nullptr) {
+        switch (data.reward_scheme_data_type) {
+        case BlockDataType::basic:
+            reward_scheme_data = *data.reward_scheme_data;
+            break;
+        case BlockDataType::qb:
+            reward_scheme_data = static_cast<const QBBlockMetaData&>(*data.reward_scheme_data);
+            break;
+        }
+    }
     j = nlohmann::json{
         {"time", data.time},
         {"is_uncle", data.is_uncle},
-        {"pool_name", data.pool_name},
+        {"pool_name", *data.pool_name},
         {"miner_address", data.miner_address},
-        {"reward_scheme_data", data.reward_scheme_data}
+        {"reward_scheme_data", reward_scheme_data}
+    };
+}
+
+void to_json(nlohmann::json& j, const BlockMetaData& b) {
+    j = nlohmann::json{
+        {"shares_per_block", b.shares_per_block},
+        {"pool_luck", b.pool_luck}
     };
 }
 
+void to_json(nlohmann::json& j, const QBBlockMetaData& b) {
+    j = nlohmann::json{
+        {"shares_per_block", b.shares_per_block},
+        {"pool_luck", b.pool_luck},
+        {"credit_balance_receiver", b.credit_balance_receiver},
+        {"receiver_address", b.receiver_address},
+        {"reset_balance_receiver", b.reset_balance_receiver},
+        {"proportion_credits_lost", b.prop_credits_lost},
+        {"total_credits_lost", b.total_credits_lost},
+        {"average_credits_lost", b.average_credits_lost}
+    };
+}
+
+void write_json(JSONWriter& writer, const BlockEvent& data, uint8_t fields, OutputDictionary* dictionary) {
+    writer.start_object();
+    write_json_fields(writer, data, fields, dictionary);
+    writer.end_object();
+}
+
+void write_json_fields(JSONWriter& writer, const BlockEvent& data, uint8_t fields,
+                       OutputDictionary* dictionary) {
+    if (fields & BlockField::is_uncle) {
+        writer.key("is_uncle");
+        writer.value(data.is_uncle);
+    }
+    if (fields & BlockField::miner_address) {
+        write_address(writer, "miner_address", "miner_id", data.miner_address, dictionary);
+    }
+    if (fields & BlockField::pool_name) {
+        write_pool_name(writer, "pool_name", "pool_id", *data.pool_name, dictionary);
+    }
+    if (fields & BlockField::reward_scheme_data) {
+        writer.key("reward_scheme_data");
+        if (data.reward_scheme_data == nullptr) {
+            writer.value(nullptr);
+        } else if (data.reward_scheme_data_type == BlockDataType::qb) {
+            write_json(writer, static_cast<const QBBlockMetaData&>(*data.reward_scheme_data), dictionary);
+        } else {
+            write_json(writer, *data.reward_scheme_data);
+        }
+    }
+    if (fields & BlockField::time) {
+        writer.key("time");
+        writer.value(data.time);
+    }
+}
+
+void write_json(JSONWriter& writer, const BlockMetaData& b) {
+    writer.start_object();
+    writer.key("pool_luck");
+    writer.value(b.pool_luck);
+    writer.key("shares_per_block");
+    writer.value(b.shares_per_block);
+    writer.end_object();
+}
+
+void write_json(JSONWriter& writer, const QBBlockMetaData& b, OutputDictionary* dictionary) {
+    writer.start_object();
+    writer.key("average_credits_lost");
+    writer.value(b.average_credits_lost);
+    writer.key("credit_balance_receiver");
+    writer.value(b.credit_balance_receiver);
+    writer.key("pool_luck");
+    writer.value(b.pool_luck);
+    writer.key("proportion_credits_lost");
+    writer.value(b.prop_credits_lost);
+    write_address(writer, "receiver_address", "receiver_id", b.receiver_address, dictionary);
+    writer.key("reset_balance_receiver");
+    writer.value(b.reset_balance_receiver);
+    writer.key("shares_per_block");
+    writer.value(b.shares_per_block);
+    writer.key("total_credits_lost");
+    writer.value(b.total_credits_lost);
+    writer.end_object();
+}
+
 }
@@ -1,19 +1,92 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include "nlohmann/json.hpp"
+#include "address.h"
+#include "json_writer.h"
+#include "output_dictionary.h"
 
 
 namespace poolsim {
 
+struct BlockMetaData {
+    uint64_t shares_per_block = 0;
+    double pool_luck = 0;
+};
+
+struct QBBlockMetaData : BlockMetaData {
+    uint64_t credit_balance_receiver = 0;
+    Address receiver_address;
+    uint64_t reset_balance_receiver = 0;
+    double prop_credits_lost = 0;
+    double total_credits_lost = 0;
+    double average_credits_lost = 0;
+};
+
+// Type of the reward scheme data attached to a block
+enum class BlockDataType : uint8_t {
+    basic,
+    qb
+};
+
+// Maps a block metadata struct to its BlockDataType
+template <typename BlockData>
+struct block_data_type;
+
+template <>
+struct block_data_type<BlockMetaData> {
+    static const BlockDataType value = BlockDataType::basic;
+};
+
+template <>
+struct block_data_type<QBBlockMetaData> {
+    static const BlockDataType value = BlockDataType::qb;
+};
+
 struct BlockEvent {
     double time;
     bool is_uncle;
-    std::string pool_name;
-    std::string miner_address;
-    nlohmann::json reward_scheme_data;
+    // Points to the name of the pool, which outlives the event, so that decimated events cost no copy
+    const std::string* pool_name;
+    Address miner_address;
+    BlockDataType reward_scheme_data_type;
+    // Points to a BlockMetaData or a QBBlockMetaData depending on reward_scheme_data_type
+    // It is owned by the reward scheme and only valid while the event is processed,
+    // so observers keeping the event must copy it
+    const BlockMetaData* reward_scheme_data;
+};
+
+// Fields of a BlockEvent, combined to select the ones written to the results
+struct BlockField {
+    enum : uint8_t {
+        none = 0,
+        time = 1 << 0,
+        is_uncle = 1 << 1,
+        pool_name = 1 << 2,
+        miner_address = 1 << 3,
+        reward_scheme_data = 1 << 4,
+        all = (1 << 5) - 1
+    };
+
+    // Returns the field with the given name, as written in the results
+    // Throws std::invalid_argument if there is no such field
+    static uint8_t from_name(const std::string& name);
 };
 
 void to_json(nlohmann::json& j, const BlockEvent& data);
+void to_json(nlohmann::json& j, const BlockMetaData& b);
+void to_json(nlohmann::json& j, const QBBlockMetaData& b);
+
+// Writes the same JSON as to_json, keys excluded from the enclosing object for the _fields variant
+// Only the BlockField set in fields are written
+// With a dictionary, pool_id, miner_id and receiver_id keys hold the IDs of the pool name
+// and addresses in place of pool_name, miner_address and receiver_address
+void write_json(JSONWriter& writer, const BlockEvent& data, uint8_t fields = BlockField::all,
+                OutputDictionary* dictionary = nullptr);
+void write_json_fields(JSONWriter& writer, const BlockEvent& data, uint8_t fields = BlockField::all,
+                       OutputDictionary* dictionary = nullptr);
+void write_json(JSONWriter& writer, const BlockMetaData& b);
+void write_json(JSONWriter& writer, const QBBlockMetaData& b, OutputDictionary* dictionary = nullptr);
 
 }
@@ -7,6 +7,8 @@
 #include "cli.h"
 #include "simulator.h"
 #include "miner_creator.h"
+#include "result_index.h"
+#include "tracer.h"
 
 
 namespace poolsim {
@@ -21,6 +23,22 @@ Cli::Cli() {
     app->add_option("-s,--seed", args->seed, "random seed value")
         ->required();
     app->add_flag("--debug", args->debug, "enable debug logs");
+    app->add_flag("--perf-counters", args->perf_counters,
+                  "add the hardware events counted during the simulation and the peak RSS to the results");
+    args->trace_interval = default_trace_interval;
+    app->add_option("--trace", args->trace_filepath,
+                    "write a Chrome trace event file of the simulation phases, for chrome://tracing or Perfetto");
+    app->add_option("--trace-interval", args->trace_interval,
+                    "events of the event loop covered by each of its spans in the trace", true);
+    args->status_interval = default_progress_interval;
+    app->add_option("--status", args->status_destination,
+                    "report the progress as JSON to a file replaced atomically, or as lines to stderr with -");
+    app->add_option("--status-interval", args->status_interval, "seconds between two progress reports", true);
+    args->memory_checkpoints = default_memory_checkpoints;
+    app->add_option("--memory-report", args->memory_report_destination,
+                    "report the RSS and the estimated bytes of each structure as JSON lines to a file, or to stderr with -");
+    app->add_option("--memory-checkpoints", args->memory_checkpoints,
+                    "memory reports during the simulation, besides the final one", true);
 }
 
 int Cli::run(int argc, char* argv[]) {
@@ -31,11 +49,33 @@ int Cli::run(int argc, char* argv[]) {
         spdlog::set_level(spdlog::level::debug);
     }
 
-    auto simulator = Simulator::from_config_file(args->config_filepath, args->seed);
+    if (!args->trace_filepath.empty()) {
+        Tracer::get_instance().enable(args->trace_interval);
+        Tracer::get_instance().set_thread_name("simulation");
+    }
+
+    std::shared_ptr<Simulator> simulator;
+    {
+        TraceSpan span("initialize", "load_config");
+        simulator = Simulator::from_config_file(args->config_filepath, args->seed);
+    }
+    if (args->perf_counters) {
+        simulator->enable_perf_counters();
+    }
+    if (!args->status_destination.empty()) {
+        simulator->enable_progress_reports(args->status_destination, args->status_interval);
+    }
+    if (!args->memory_report_destination.empty()) {
+        simulator->enable_memory_reports(args->memory_report_destination, args->memory_checkpoints);
+    }
     simulator->run();
 
     simulator->save_simulation_data();
 
+    if (!args->trace_filepath.empty()) {
+        Tracer::get_instance().write(args->trace_filepath);
+    }
+
     return 0;
 }
 
@@ -56,4 +96,30 @@ int run(int argc, char **argv) {
     return 0;
 }
 
+int run_query(int argc, char* argv[]) {
+    CLI::App app("poolsim-query: Query the results of a miner using the index written next to the results");
+    std::string results_filepath, address;
+    app.add_option("results-file", results_filepath, "results file")
+       ->required()
+       ->check(CLI::ExistingFile);
+    app.add_option("address", address, "miner address")
+       ->required();
+
+    try {
+        app.parse(argc, argv);
+    } catch(const CLI::ParseError &e) {
+        return app.exit(e);
+    }
+
+    try {
+        nlohmann::json info = query_miner_info(results_filepath, address);
+        std::cout << info.dump() << std::endl;
+    } catch(const std::invalid_argument &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
 }
\ No newline at end of file
@@ -12,6 +12,13 @@ struct CliArgs {
     std::string config_filepath;
     int seed;
     bool debug;
+    bool perf_counters;
+    std::string trace_filepath;
+    uint64_t trace_interval;
+    std::string status_destination;
+    double status_interval;
+    std::string memory_report_destination;
+    uint64_t memory_checkpoints;
 };
 
 class Cli {
@@ -28,4 +35,7 @@ private:
 
 int run(int argc, char* argv[]);
 
+// Entry point of poolsim-query, which prints the aggregated results of a miner
+int run_query(int argc, char* argv[]);
+
 }
@@ -0,0 +1,204 @@
+#include <fstream>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "columnar.h"
+#include "tracer.h"
+
+namespace poolsim {
+
+const char columnar_magic[8] = {'P', 'O', 'O', 'L', 'S', 'I', 'M', 'C'};
+
+static const uint64_t column_alignment = 8;
+
+static uint64_t align(uint64_t offset) {
+    return (offset + column_alignment - 1) / column_alignment * column_alignment;
+}
+
+static size_t value_size(ColumnType type) {
+    switch (type) {
+    case ColumnType::u8: return 1;
+    case ColumnType::u32: return 4;
+    case ColumnType::u64: return 8;
+    case ColumnType::f64: return 8;
+    case ColumnType::string: return 0;
+    }
+    return 0;
+}
+
+ColumnarFormatException::ColumnarFormatException(const std::string& message)
+    : std::runtime_error(message) {}
+
+void ColumnarWriter::add_column(const std::string& name, ColumnType type, const void* data,
+                                uint64_t length, uint64_t size) {
+    PendingColumn column;
+    std::memset(&column.header, 0, sizeof(column.header));
+    if (name.size() >= sizeof(column.header.name)) {
+        throw std::invalid_argument("column name too long: " + name);
+    }
+    std::memcpy(column.header.name, name.data(), name.size());
+    column.header.type = type;
+    column.header.length = length;
+    column.header.size = size;
+    column.data = static_cast<const char*>(data);
+    columns.push_back(column);
+}
+
+void ColumnarWriter::add_string_column(const std::string& name, const std::vector<std::string>& values) {
+    std::vector<uint64_t> offsets;
+    offsets.reserve(values.size() + 1);
+    uint64_t offset = 0;
+    offsets.push_back(offset);
+    for (const std::string& value : values) {
+        offset += value.size();
+        offsets.push_back(offset);
+    }
+
+    auto buffer = std::make_shared<std::string>();
+    buffer->reserve(offsets.size() * sizeof(uint64_t) + offset);
+    buffer->append(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    for (const std::string& value : values) {
+        buffer->append(value);
+    }
+
+    add_column(name, ColumnType::string, buffer->data(), values.size(), buffer->size());
+    columns.back().buffer = buffer;
+}
+
+void ColumnarWriter::write(const std::string& filepath) const {
+    TraceSpan span("output", "write_columns");
+    ColumnarFileHeader file_header;
+    std::memcpy(file_header.magic, columnar_magic, sizeof(file_header.magic));
+    file_header.version = columnar_version;
+    file_header.column_count = static_cast<uint32_t>(columns.size());
+
+    std::vector<ColumnHeader> headers;
+    uint64_t offset = align(sizeof(ColumnarFileHeader) + columns.size() * sizeof(ColumnHeader));
+    for (const PendingColumn& column : columns) {
+        ColumnHeader header = column.header;
+        header.offset = offset;
+        headers.push_back(header);
+        offset = align(offset + header.size);
+    }
+
+    std::ofstream output(filepath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    if (!output) {
+        throw std::invalid_argument("cannot open " + filepath);
+    }
+    const char padding[column_alignment] = {};
+    uint64_t position = sizeof(ColumnarFileHeader) + headers.size() * sizeof(ColumnHeader);
+    output.write(reinterpret_cast<const char*>(&file_header), sizeof(file_header));
+    output.write(reinterpret_cast<const char*>(headers.data()), headers.size() * sizeof(ColumnHeader));
+    for (size_t i = 0; i < columns.size(); i++) {
+        output.write(padding, headers[i].offset - position);
+        output.write(columns[i].data, headers[i].size);
+        position = headers[i].offset + headers[i].size;
+    }
+}
+
+StringColumnView::StringColumnView(const uint64_t* _offsets, const char* _chars, size_t _length)
+    : offsets(_offsets), chars(_chars), length(_length) {}
+
+std::string StringColumnView::operator[](size_t index) const {
+    return std::string(chars + offsets[index], offsets[index + 1] - offsets[index]);
+}
+
+size_t StringColumnView::size() const {
+    return length;
+}
+
+ColumnarReader::ColumnarReader(const std::string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::invalid_argument("cannot open " + filepath);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t)sizeof(ColumnarFileHeader)) {
+        close(fd);
+        throw ColumnarFormatException(filepath + " is not a columnar file");
+    }
+    size = file_stat.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("cannot map " + filepath);
+    }
+    data = static_cast<const char*>(mapped);
+
+    const ColumnarFileHeader* header = reinterpret_cast<const ColumnarFileHeader*>(data);
+    if (std::memcmp(header->magic, columnar_magic, sizeof(columnar_magic)) != 0) {
+        munmap(const_cast<char*>(data), size);
+        throw ColumnarFormatException(filepath + " is not a columnar file");
+    }
+    if (header->version != columnar_version) {
+        munmap(const_cast<char*>(data), size);
+        throw ColumnarFormatException("unsupported columnar file version in " + filepath);
+    }
+    column_count = header->column_count;
+    columns = reinterpret_cast<const ColumnHeader*>(data + sizeof(ColumnarFileHeader));
+    if (sizeof(ColumnarFileHeader) + column_count * sizeof(ColumnHeader) > size) {
+        munmap(const_cast<char*>(data), size);
+        throw ColumnarFormatException(filepath + " is truncated");
+    }
+    for (size_t i = 0; i < column_count; i++) {
+        if (columns[i].offset + columns[i].size > size) {
+            munmap(const_cast<char*>(data), size);
+            throw ColumnarFormatException(filepath + " is truncated");
+        }
+    }
+}
+
+ColumnarReader::~ColumnarReader() {
+    munmap(const_cast<char*>(data), size);
+}
+
+bool ColumnarReader::has_column(const std::string& name) const {
+    for (size_t i = 0; i < column_count; i++) {
+        if (strncmp(columns[i].name, name.c_str(), sizeof(columns[i].name)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::string> ColumnarReader::get_column_names() const {
+    std::vector<std::string> names;
+    for (size_t i = 0; i < column_count; i++) {
+        names.push_back(std::string(columns[i].name, strnlen(columns[i].name, sizeof(columns[i].name))));
+    }
+    return names;
+}
+
+const ColumnHeader& ColumnarReader::find_column(const std::string& name, ColumnType type) const {
+    for (size_t i = 0; i < column_count; i++) {
+        if (strncmp(columns[i].name, name.c_str(), sizeof(columns[i].name)) != 0) {
+            continue;
+        }
+        if (columns[i].type != type) {
+            throw ColumnarFormatException("column " + name + " has a different type");
+        }
+        if (type != ColumnType::string && columns[i].length * value_size(type) != columns[i].size) {
+            throw ColumnarFormatException("column " + name + " is corrupted");
+        }
+        return columns[i];
+    }
+    throw ColumnarFormatException("column " + name + " does not exist");
+}
+
+StringColumnView ColumnarReader::get_string_column(const std::string& name) const {
+    const ColumnHeader& column = find_column(name, ColumnType::string);
+    uint64_t offsets_size = (column.length + 1) * sizeof(uint64_t);
+    if (offsets_size > column.size
+            || reinterpret_cast<const uint64_t*>(data + column.offset)[column.length] > column.size - offsets_size) {
+        throw ColumnarFormatException("column " + name + " is corrupted");
+    }
+    const uint64_t* offsets = reinterpret_cast<const uint64_t*>(data + column.offset);
+    const char* chars = reinterpret_cast<const char*>(offsets + column.length + 1);
+    return StringColumnView(offsets, chars, column.length);
+}
+
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+namespace poolsim {
+
+// Binary columnar files
+//
+// A file starts with a ColumnarFileHeader followed by column_count ColumnHeader.
+// The data of each column starts at an 8-byte aligned offset from the beginning
+// of the file. Numeric columns hold `length` little-endian values. String columns
+// hold `length + 1` uint64_t offsets, relative to the end of the offsets, followed
+// by the concatenated characters.
+
+enum class ColumnType : uint32_t {
+    u8 = 1,
+    u32 = 2,
+    u64 = 3,
+    f64 = 4,
+    string = 5
+};
+
+struct ColumnarFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t column_count;
+};
+
+struct ColumnHeader {
+    char name[48];
+    ColumnType type;
+    uint32_t reserved;
+    // position of the data from the beginning of the file
+    uint64_t offset;
+    // number of values in the column
+    uint64_t length;
+    // number of bytes of data
+    uint64_t size;
+};
+
+extern const char columnar_magic[8];
+const uint32_t columnar_version = 1;
+
+// Maps a C++ type to the type of the column storing it
+template <typename T>
+struct column_type;
+
+template <> struct column_type<uint8_t> { static const ColumnType value = ColumnType::u8; };
+template <> struct column_type<uint32_t> { static const ColumnType value = ColumnType::u32; };
+template <> struct column_type<uint64_t> { static const ColumnType value = ColumnType::u64; };
+template <> struct column_type<double> { static const ColumnType value = ColumnType::f64; };
+
+class ColumnarFormatException : public std::runtime_error {
+public:
+    explicit ColumnarFormatException(const std::string& message);
+};
+
+// Collects columns and writes them to a columnar file
+// Numeric columns are referenced, not copied, and must stay alive until write is called
+class ColumnarWriter {
+public:
+    template <typename T>
+    void add_column(const std::string& name, const std::vector<T>& values);
+
+    void add_string_column(const std::string& name, const std::vector<std::string>& values);
+
+    // Writes all the columns to the file
+    void write(const std::string& filepath) const;
+private:
+    struct PendingColumn {
+        ColumnHeader header;
+        const char* data;
+        // owns the data of string columns
+        std::shared_ptr<std::string> buffer;
+    };
+
+    void add_column(const std::string& name, ColumnType type, const void* data,
+                    uint64_t length, uint64_t size);
+
+    std::vector<PendingColumn> columns;
+};
+
+template <typename T>
+void ColumnarWriter::add_column(const std::string& name, const std::vector<T>& values) {
+    add_column(name, column_type<T>::value, values.data(), values.size(), values.size() * sizeof(T));
+}
+
+// Read-only view over a numeric column of a mapped file
+template <typename T>
+class ColumnView {
+public:
+    ColumnView(const T* _values, size_t _length) : values(_values), length(_length) {}
+
+    inline const T& operator[](size_t index) const { return values[index]; }
+    inline size_t size() const { return length; }
+    inline const T* begin() const { return values; }
+    inline const T* end() const { return values + length; }
+private:
+    const T* values;
+    size_t length;
+};
+
+// Read-only view over a string column of a mapped file
+class StringColumnView {
+public:
+    StringColumnView(const uint64_t* offsets, const char* chars, size_t length);
+
+    std::string operator[](size_t index) const;
+    size_t size() const;
+private:
+    const uint64_t* offsets;
+    const char* chars;
+    size_t length;
+};
+
+// Memory-maps a columnar file
+// Columns are only read from disk when they are accessed
+class ColumnarReader {
+public:
+    explicit ColumnarReader(const std::string& filepath);
+    ~ColumnarReader();
+
+    ColumnarReader(ColumnarReader const&) = delete;
+    void operator=(ColumnarReader const&) = delete;
+
+    // Returns true if the file has a column with the given name
+    bool has_column(const std::string& name) const;
+
+    // Returns the names of all the columns in the file
+    std::vector<std::string> get_column_names() const;
+
+    // Returns the numeric column with the given name
+    // Throws if it does not exist or has a different type
+    template <typename T>
+    ColumnView<T> get_column(const std::string& name) const;
+
+    // Returns the string column with the given name
+    StringColumnView get_string_column(const std::string& name) const;
+private:
+    const ColumnHeader& find_column(const std::string& name, ColumnType type) const;
+
+    const char* data = nullptr;
+    size_t size = 0;
+    const ColumnHeader* columns = nullptr;
+    size_t column_count = 0;
+};
+
+template <typename T>
+ColumnView<T> ColumnarReader::get_column(const std::string& name) const {
+    const ColumnHeader& column = find_column(name, column_type<T>::value);
+    return ColumnView<T>(reinterpret_cast<const T*>(data + column.offset), column.length);
+}
+
+}
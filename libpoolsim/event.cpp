@@ -2,7 +2,7 @@
 
 namespace poolsim {
 
-Event::Event(const std::string& _miner_address, double _time):
-  miner_address(_miner_address), time(_time) {}
+Event::Event(uint32_t _miner_id, double _time):
+  time(_time), miner_id(_miner_id) {}
 
 }
@@ -2,6 +2,7 @@
 
 #include "event_queue.h"
 #include "event.h"
+#include "profiler.h"
 
 namespace poolsim {
 
@@ -15,11 +16,17 @@ size_t EventQueue::size() const {
   return queue.size();
 }
 
+uint64_t EventQueue::get_memory_usage() const {
+  // priority_queue does not expose the capacity of its vector
+  return queue.size() * sizeof(Event);
+}
+
 void EventQueue::schedule(Event event) {
   queue.push(event);
 }
 
 Event EventQueue::pop() {
+  POOLSIM_PROFILE_SCOPE(event_pop);
   Event event = get_top();
   queue.pop();
   return event;
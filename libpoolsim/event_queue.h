@@ -21,6 +21,9 @@ public:
 
   size_t size() const;
 
+  // Returns the estimated bytes held by the queue
+  uint64_t get_memory_usage() const;
+
   // Schedules a new share event
   void schedule(Event _event);
 
@@ -0,0 +1,227 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include <zlib.h>
+
+#include "gzip_stream.h"
+#include "tracer.h"
+
+namespace poolsim {
+
+// size of the deflate window, the most a dictionary can be useful for
+static const size_t gzip_window_size = 1 << 15;
+
+static void append_uint32(std::string& output, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        output += static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+GzipStreamBuffer::GzipStreamBuffer(const std::string& _filepath, unsigned int threads, size_t block_size)
+    : filepath(_filepath),
+      file(_filepath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc),
+      buffer(std::max<size_t>(block_size, 1)) {
+    if (!file) {
+        throw std::invalid_argument("cannot open " + filepath);
+    }
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    // enough blocks to keep all threads busy while the caller fills the next one
+    max_pending = 2 * threads;
+    crc = crc32(0, Z_NULL, 0);
+    write_header();
+    setp(buffer.data(), buffer.data() + buffer.size());
+    for (unsigned int i = 0; i < threads; i++) {
+        workers.push_back(std::thread(&GzipStreamBuffer::run_worker, this));
+    }
+}
+
+GzipStreamBuffer::~GzipStreamBuffer() {
+    try {
+        close();
+    } catch (const std::exception&) {
+        // errors can only be reported by an explicit close
+    }
+    stop_workers();
+}
+
+GzipStreamBuffer::int_type GzipStreamBuffer::overflow(int_type c) {
+    if (closed) {
+        return traits_type::eof();
+    }
+    submit_block(false);
+    write_blocks(max_pending);
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+void GzipStreamBuffer::close() {
+    if (closed) {
+        return;
+    }
+    closed = true;
+    TraceSpan span("output", "close_gzip");
+    try {
+        submit_block(true);
+        write_blocks(0);
+        write_trailer();
+    } catch (...) {
+        stop_workers();
+        throw;
+    }
+    stop_workers();
+    file.close();
+    if (!file) {
+        throw std::runtime_error("cannot write " + filepath);
+    }
+}
+
+void GzipStreamBuffer::submit_block(bool last) {
+    auto block = std::make_shared<Block>();
+    block->input.assign(pbase(), pptr());
+    block->dictionary = dictionary;
+    block->last = last;
+    setp(buffer.data(), buffer.data() + buffer.size());
+
+    if (block->input.size() >= gzip_window_size) {
+        dictionary.assign(block->input, block->input.size() - gzip_window_size, gzip_window_size);
+    } else {
+        dictionary += block->input;
+        if (dictionary.size() > gzip_window_size) {
+            dictionary.erase(0, dictionary.size() - gzip_window_size);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(block);
+    queue.push_back(block);
+    block_queued.notify_one();
+}
+
+void GzipStreamBuffer::write_blocks(size_t max_blocks) {
+    while (!pending.empty()) {
+        std::shared_ptr<Block> block = pending.front();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!block->done && pending.size() <= max_blocks) {
+                return;
+            }
+            block_done.wait(lock, [&block] { return block->done; });
+        }
+        if (!block->error.empty()) {
+            throw std::runtime_error("cannot compress " + filepath + ": " + block->error);
+        }
+        file.write(block->output.data(), block->output.size());
+        if (!file) {
+            throw std::runtime_error("cannot write " + filepath);
+        }
+        crc = crc32_combine(crc, block->crc, block->input.size());
+        input_size += block->input.size();
+        pending.pop_front();
+    }
+}
+
+void GzipStreamBuffer::write_header() {
+    // no file name nor modification time, unix as operating system
+    const char header[10] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, 3};
+    file.write(header, sizeof(header));
+}
+
+void GzipStreamBuffer::write_trailer() {
+    std::string trailer;
+    append_uint32(trailer, crc);
+    // the size is stored modulo 2^32
+    append_uint32(trailer, static_cast<uint32_t>(input_size));
+    file.write(trailer.data(), trailer.size());
+}
+
+void GzipStreamBuffer::stop_workers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    block_queued.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void GzipStreamBuffer::run_worker() {
+    Tracer::get_instance().set_thread_name("gzip");
+    while (true) {
+        std::shared_ptr<Block> block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            block_queued.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            block = queue.front();
+            queue.pop_front();
+        }
+        compress_block(*block);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            block->done = true;
+        }
+        block_done.notify_all();
+    }
+}
+
+void GzipStreamBuffer::compress_block(Block& block) {
+    TraceSpan span("output", "compress", {{"bytes", block.input.size()}});
+    const Bytef* input = reinterpret_cast<const Bytef*>(block.input.data());
+    block.crc = crc32(crc32(0, Z_NULL, 0), input, block.input.size());
+
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    // negative window bits: raw deflate, the gzip header is written once for all blocks
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        block.error = "cannot initialize zlib";
+        return;
+    }
+    if (!block.dictionary.empty()) {
+        deflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(block.dictionary.data()),
+                             block.dictionary.size());
+    }
+
+    // blocks other than the last one end on a byte boundary with an empty
+    // stored block, so that they can be concatenated
+    int flush = block.last ? Z_FINISH : Z_SYNC_FLUSH;
+    block.output.resize(deflateBound(&stream, block.input.size()) + 16);
+    stream.next_in = const_cast<Bytef*>(input);
+    stream.avail_in = block.input.size();
+    int status = Z_OK;
+    do {
+        if (stream.total_out == block.output.size()) {
+            block.output.resize(2 * block.output.size());
+        }
+        stream.next_out = reinterpret_cast<Bytef*>(&block.output[stream.total_out]);
+        stream.avail_out = block.output.size() - stream.total_out;
+        status = deflate(&stream, flush);
+    } while (status == Z_OK && (stream.avail_out == 0 || stream.avail_in > 0 || block.last));
+
+    if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+        block.error = stream.msg != Z_NULL ? stream.msg : "deflate failed";
+    }
+    block.output.resize(stream.total_out);
+    deflateEnd(&stream);
+}
+
+GzipOutputStream::GzipOutputStream(const std::string& filepath, unsigned int threads, size_t block_size)
+    : std::ostream(nullptr), buffer(filepath, threads, block_size) {
+    rdbuf(&buffer);
+}
+
+void GzipOutputStream::close() {
+    buffer.close();
+}
+
+}
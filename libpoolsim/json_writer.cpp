@@ -0,0 +1,201 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "json_writer.h"
+
+namespace poolsim {
+
+// size above which the buffer is written to the stream
+static const size_t json_buffer_size = 1 << 16;
+
+JSONWriter::JSONWriter(std::ostream& _output, int _indent)
+    : output(_output), indent(_indent) {
+    buffer.reserve(json_buffer_size);
+}
+
+JSONWriter::~JSONWriter() {
+    flush();
+}
+
+void JSONWriter::flush() {
+    output.write(buffer.data(), buffer.size());
+    flushed += buffer.size();
+    buffer.clear();
+}
+
+uint64_t JSONWriter::get_offset() const {
+    return flushed + buffer.size();
+}
+
+void JSONWriter::write(const char* data, size_t size) {
+    buffer.append(data, size);
+    if (buffer.size() >= json_buffer_size) {
+        flush();
+    }
+}
+
+void JSONWriter::raw(const char* text) {
+    write(text, std::strlen(text));
+}
+
+void JSONWriter::newline(size_t depth) {
+    if (indent < 0) {
+        return;
+    }
+    buffer += '\n';
+    buffer.append(depth * indent, ' ');
+}
+
+void JSONWriter::prefix() {
+    if (after_key) {
+        after_key = false;
+        return;
+    }
+    if (scopes.empty()) {
+        return;
+    }
+    if (scopes.back().count++ > 0) {
+        buffer += ',';
+    }
+    newline(scopes.size());
+}
+
+void JSONWriter::start_object() {
+    prefix();
+    buffer += '{';
+    scopes.push_back(Scope {true, 0});
+}
+
+void JSONWriter::end_object() {
+    if (scopes.back().count > 0) {
+        newline(scopes.size() - 1);
+    }
+    scopes.pop_back();
+    write("}", 1);
+}
+
+void JSONWriter::start_array() {
+    prefix();
+    buffer += '[';
+    scopes.push_back(Scope {false, 0});
+}
+
+void JSONWriter::end_array() {
+    if (scopes.back().count > 0) {
+        newline(scopes.size() - 1);
+    }
+    scopes.pop_back();
+    write("]", 1);
+}
+
+void JSONWriter::key(const char* name) {
+    prefix();
+    write_string(name, std::strlen(name));
+    if (indent < 0) {
+        buffer += ':';
+    } else {
+        buffer += ": ";
+    }
+    after_key = true;
+}
+
+void JSONWriter::write_string(const char* value, size_t size) {
+    buffer += '"';
+    for (size_t i = 0; i < size; i++) {
+        char c = value[i];
+        switch (c) {
+        case '"': buffer += "\\\""; break;
+        case '\\': buffer += "\\\\"; break;
+        case '\b': buffer += "\\b"; break;
+        case '\f': buffer += "\\f"; break;
+        case '\n': buffer += "\\n"; break;
+        case '\r': buffer += "\\r"; break;
+        case '\t': buffer += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+                buffer += escaped;
+            } else {
+                buffer += c;
+            }
+        }
+    }
+    write("\"", 1);
+}
+
+void JSONWriter::value(const std::string& value) {
+    prefix();
+    write_string(value.data(), value.size());
+}
+
+void JSONWriter::value(const char* value) {
+    prefix();
+    write_string(value, std::strlen(value));
+}
+
+void JSONWriter::value(Address value) {
+    this->value(value.to_string());
+}
+
+void JSONWriter::value(bool value) {
+    prefix();
+    if (value) {
+        write("true", 4);
+    } else {
+        write("false", 5);
+    }
+}
+
+void JSONWriter::value(double value) {
+    prefix();
+    if (!std::isfinite(value)) {
+        write("null", 4);
+        return;
+    }
+    // same formatting as nlohmann::json
+    char number[64];
+    char* end = nlohmann::detail::to_chars(number, number + sizeof(number), value);
+    write(number, end - number);
+}
+
+void JSONWriter::value(uint64_t value) {
+    prefix();
+    char number[24];
+    int size = std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value));
+    write(number, size);
+}
+
+void JSONWriter::value(int64_t value) {
+    prefix();
+    char number[24];
+    int size = std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(value));
+    write(number, size);
+}
+
+void JSONWriter::value(std::nullptr_t) {
+    prefix();
+    write("null", 4);
+}
+
+void JSONWriter::value(const nlohmann::json& value) {
+    prefix();
+    std::string dumped = value.dump(indent);
+    if (indent < 0 || scopes.empty()) {
+        write(dumped.data(), dumped.size());
+        return;
+    }
+    // nested lines must be shifted to the current depth
+    std::string shift = "\n" + std::string(scopes.size() * indent, ' ');
+    size_t start = 0;
+    for (size_t end = dumped.find('\n'); end != std::string::npos; end = dumped.find('\n', start)) {
+        buffer.append(dumped, start, end - start);
+        buffer += shift;
+        start = end + 1;
+    }
+    buffer.append(dumped, start, std::string::npos);
+    write("", 0);
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace poolsim {
+
+// Estimated bytes held by the structures of a simulation, by structure name
+// Estimates count the memory owned through containers and shared pointers,
+// not the overhead of the allocator
+typedef std::map<std::string, uint64_t> MemoryUsage;
+
+// size of the control block of an object created with std::make_shared
+const size_t shared_control_block_size = 2 * sizeof(void*);
+
+// size of a node of a std::list, besides its value
+const size_t list_node_overhead = 2 * sizeof(void*);
+
+// Returns the bytes reserved by a vector for its elements
+template <typename T>
+inline uint64_t get_memory_usage(const std::vector<T>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+// Returns the bytes allocated by an unordered_map for its nodes and buckets
+template <typename K, typename V>
+inline uint64_t get_memory_usage(const std::unordered_map<K, V>& values) {
+    return values.size() * (sizeof(void*) + sizeof(std::pair<const K, V>)) +
+           values.bucket_count() * sizeof(void*);
+}
+
+// Returns the bytes allocated by a string, 0 when it fits in the string itself
+inline uint64_t get_memory_usage(const std::string& value) {
+    return value.capacity() > sizeof(std::string) - 1 ? value.capacity() + 1 : 0;
+}
+
+}
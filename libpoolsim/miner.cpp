@@ -1,3 +1,5 @@
+#include <cmath>
+#include <limits>
 #include <stdexcept>
 
 #include "miner.h"
@@ -6,23 +8,37 @@
 namespace poolsim {
 
 
-Miner::Miner(std::string _address, double _hashrate, std::shared_ptr<Network> _network)
-  : address(_address), hashrate(_hashrate), network(_network) {}
+Miner::Miner(Address _address, double _hashrate, std::shared_ptr<Network> _network)
+  : detached_state(new MinerState()), address(_address), network(_network) {
+  detached_state->hashrate = _hashrate;
+}
 
-std::shared_ptr<Miner> Miner::create(std::string address, double hashrate,
-                    std::unique_ptr<ShareHandler> handler,
+std::shared_ptr<Miner> Miner::create(Address address, double hashrate,
+                    std::shared_ptr<ShareHandler> handler,
                     std::shared_ptr<Network> network) {
   if (handler == nullptr) {
     throw std::invalid_argument("handler cannot be null");
   }
   auto miner = std::shared_ptr<Miner>(new Miner(address, hashrate, network));
-  miner->set_handler(std::move(handler));
+  miner->set_handler(handler);
   return miner;
 }
 
-std::string Miner::get_address() const { return address; }
+Address Miner::get_address() const { return address; }
+
+double Miner::get_hashrate() const { return state().hashrate; }
+
+uint32_t Miner::get_id() const { return id; }
 
-double Miner::get_hashrate() const { return hashrate; }
+MinerState& Miner::state() { return table == nullptr ? *detached_state : (*table)[id]; }
+
+const MinerState& Miner::state() const { return table == nullptr ? *detached_state : (*table)[id]; }
+
+void Miner::move_to_table(MinerTable& _table) {
+  id = _table.add(state());
+  table = &_table;
+  detached_state.reset();
+}
 
 std::shared_ptr<MiningPool> Miner::get_pool() const {
   return pool.lock();
@@ -33,11 +49,11 @@ std::shared_ptr<Network> Miner::get_network() const {
 }
 
 uint64_t Miner::get_blocks_found() const {
-    return blocks_found;
+    return state().blocks_found;
 }
 
 uint64_t Miner::get_total_work() const {
-    return total_work;
+    return state().total_work;
 }
 
 
@@ -52,22 +68,65 @@ void Miner::join_pool(std::shared_ptr<MiningPool> _pool) {
   }
   pool = _pool;
   get_pool()->join(get_address());
+  refresh_scheduling();
+}
+
+const SchedulingEntry& Miner::get_scheduling() const {
+    return state().scheduling;
+}
+
+void Miner::refresh_scheduling() {
+    MinerState& miner_state = state();
+    SchedulingEntry& scheduling = miner_state.scheduling;
+    auto current_pool = get_pool();
+    if (current_pool == nullptr) {
+        miner_state.share_difficulty = 0;
+        scheduling = SchedulingEntry();
+        return;
+    }
+    uint64_t pool_difficulty = current_pool->get_difficulty();
+    miner_state.share_difficulty = pool_difficulty;
+    scheduling.share_interval = pool_difficulty / miner_state.hashrate;
+
+    auto current_network = get_network();
+    if (current_network == nullptr) {
+        scheduling.block_threshold = 0;
+        return;
+    }
+    double p = (double) pool_difficulty / current_network->get_difficulty();
+    if (p >= 1) {
+        scheduling.block_threshold = std::numeric_limits<uint64_t>::max();
+    } else {
+        // 2^64: a 64-bit uniform below this threshold has probability p
+        scheduling.block_threshold = static_cast<uint64_t>(std::ceil(p * 18446744073709551616.0));
+    }
 }
 
 void Miner::process_share(const Share& share) {
-    total_work += get_pool()->get_difficulty();
+    record_share(share);
+    state().share_handler->handle_share(*this, share);
+}
+
+void Miner::record_share(const Share& share) {
+    MinerState& miner_state = state();
+    miner_state.total_work += miner_state.share_difficulty;
     if (share.is_network_share()) {
-        blocks_found++;
+        miner_state.blocks_found++;
     }
-    share_handler->handle_share(share);
 }
 
-void Miner::set_handler(std::unique_ptr<ShareHandler> _share_handler) {
-  share_handler = std::move(_share_handler);
-  share_handler->set_miner(shared_from_this());
+void Miner::set_handler(std::shared_ptr<ShareHandler> _share_handler) {
+  share_handler = _share_handler;
+  if (!share_handler->is_flyweight()) {
+    share_handler->set_miner(shared_from_this());
+  }
+  state().share_handler = share_handler.get();
 }
 
-nlohmann::json Miner::get_handler_metadata() const {
+nlohmann::json Miner::get_handler_metadata(OutputDictionary* dictionary) const {
+    if (dictionary != nullptr) {
+        return share_handler->get_encoded_json_metadata(*dictionary);
+    }
     return share_handler->get_json_metadata();
 }
 
@@ -80,4 +139,25 @@ void to_json(nlohmann::json& j, const Miner& miner) {
     j["handler_metadata"] = miner.get_handler_metadata();
 }
 
+void write_json(JSONWriter& writer, const Miner& miner, OutputDictionary* dictionary) {
+    writer.start_object();
+    write_json_fields(writer, miner, dictionary);
+    writer.end_object();
+}
+
+void write_json_fields(JSONWriter& writer, const Miner& miner, OutputDictionary* dictionary) {
+    writer.key("address");
+    writer.value(miner.get_address());
+    writer.key("behavior");
+    writer.value(miner.get_handler_name());
+    writer.key("blocks_found");
+    writer.value(miner.get_blocks_found());
+    writer.key("handler_metadata");
+    writer.value(miner.get_handler_metadata(dictionary));
+    writer.key("hashrate");
+    writer.value(miner.get_hashrate());
+    writer.key("total_work");
+    writer.value(miner.get_total_work());
+}
+
 }
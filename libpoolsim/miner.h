@@ -7,6 +7,9 @@
 #include "mining_pool.h"
 #include "share_handler.h"
 #include "network.h"
+#include "miner_table.h"
+#include "address.h"
+#include "json_writer.h"
 
 namespace poolsim {
 
@@ -16,21 +19,26 @@ public:
     // as we only want to create them as shared_ptr
     // for the ShareHandler to be able to reference them
     static std::shared_ptr<Miner> create(
-        std::string _address, double _hashrate,
-        std::unique_ptr<ShareHandler> share_handler,
+        Address _address, double _hashrate,
+        std::shared_ptr<ShareHandler> share_handler,
         std::shared_ptr<Network> network
         );
     virtual ~Miner() {}
 
-    std::string get_address() const;
+    Address get_address() const;
     double get_hashrate() const;
     std::shared_ptr<MiningPool> get_pool() const;
 
-    void set_handler(std::unique_ptr<ShareHandler> handler);
+    // Sets the share handler of the miner
+    // Handlers are bound to the miner unless they are flyweights
+    void set_handler(std::shared_ptr<ShareHandler> handler);
 
     // Processes the share by delegating to different strategies
     virtual void process_share(const Share& share);
 
+    // Updates the work done and blocks found with the given share
+    void record_share(const Share& share);
+
     // Joins the given pool, updates the state of the pool too
     void join_pool(std::shared_ptr<MiningPool> pool);
 
@@ -46,23 +54,46 @@ public:
     // returns the name of the share handler
     std::string get_handler_name() const;
 
-    // returns the metadata of the handler
-    nlohmann::json get_handler_metadata() const;
+    // returns the metadata of the handler, encoded with the dictionary if set
+    nlohmann::json get_handler_metadata(OutputDictionary* dictionary = nullptr) const;
+
+    // Returns the cached constants used to schedule this miner
+    const SchedulingEntry& get_scheduling() const;
+
+    // Recomputes the scheduling constants from the current pool and network
+    void refresh_scheduling();
+
+    // Returns the ID of the miner in its table
+    uint32_t get_id() const;
+
+    // Moves the hot state of the miner to the given table, which must outlive the miner
+    // Miners hold their state on their own until the simulator adopts them
+    void move_to_table(MinerTable& table);
 protected:
-    Miner(std::string _address, double _hashrate, std::shared_ptr<Network> network);
+    Miner(Address _address, double _hashrate, std::shared_ptr<Network> network);
 
 private:
-    std::string address;
-    double hashrate;
-    std::weak_ptr<MiningPool> pool;
+    // Returns the hot state of the miner
+    MinerState& state();
+    const MinerState& state() const;
 
-    uint64_t blocks_found = 0;
-    uint64_t total_work = 0;
+    // table holding the state, owned by the simulator, nullptr until adopted
+    MinerTable* table = nullptr;
+    uint32_t id = 0;
+    // state of a miner which is not in a table yet
+    std::unique_ptr<MinerState> detached_state;
 
-    std::unique_ptr<ShareHandler> share_handler;
+    Address address;
+    std::weak_ptr<MiningPool> pool;
+    std::shared_ptr<ShareHandler> share_handler;
     std::weak_ptr<Network> network;
 };
 
 void to_json(nlohmann::json& j, const Miner& data);
 
+// Writes the same JSON as to_json, keys excluded from the enclosing object for the _fields variant
+// With a dictionary, the handler metadata refers to pool names and addresses by ID
+void write_json(JSONWriter& writer, const Miner& data, OutputDictionary* dictionary = nullptr);
+void write_json_fields(JSONWriter& writer, const Miner& data, OutputDictionary* dictionary = nullptr);
+
 }
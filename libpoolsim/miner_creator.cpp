@@ -57,8 +57,8 @@ std::vector<std::shared_ptr<Miner>> CSVMinerCreator::create_miners(const nlohman
     if (behavior_params.find(behavior_name) != behavior_params.end()) {
         behavior_params = behavior_params[behavior_name];
     }
-    auto share_handler = ShareHandlerFactory::create(behavior_name, behavior_params);
-    auto miner = Miner::create(address, hashrate, std::move(share_handler), network);
+    auto share_handler = create_share_handler(behavior_name, behavior_params);
+    auto miner = Miner::create(Address(address), hashrate, share_handler, network);
     miners.push_back(miner);
     behavior_name.clear();
   }
@@ -93,10 +93,10 @@ std::vector<std::shared_ptr<Miner>> RandomMinerCreator::create_miners(const nloh
         hashrate = max_hashrate;
     }
 
-    std::string address = random->get_address();
+    Address address = random->get_address();
     auto behavior_params = args["behavior"].value("params", json::object());
-    auto share_handler = ShareHandlerFactory::create(args["behavior"]["name"], behavior_params);
-    auto miner = Miner::create(address, hashrate, std::move(share_handler), network);
+    auto share_handler = create_share_handler(args["behavior"]["name"], behavior_params);
+    auto miner = Miner::create(address, hashrate, share_handler, network);
     miners.push_back(miner);
     state.miners_count++;
     state.total_hashrate += hashrate;
@@ -113,13 +113,16 @@ InlineMinerCreator::InlineMinerCreator(std::shared_ptr<Network> network)
 std::vector<std::shared_ptr<Miner>> InlineMinerCreator::create_miners(const json& args) {
     std::vector<std::shared_ptr<Miner>> miners;
     for (const json& miner_info : args["miners"]) {
-        std::string address = miner_info.value("address", random->get_address());
+        Address address = random->get_address();
+        if (miner_info.find("address") != miner_info.end()) {
+            address = Address(miner_info["address"].get<std::string>());
+        }
         double hashrate = miner_info["hashrate"];
         json behavior_info = miner_info.value("behavior", json::object());
         json behavior_params = behavior_info.value("params", json::object());
         std::string behavior_name = behavior_info.value("name", "default");
-        auto share_handler = ShareHandlerFactory::create(behavior_name, behavior_params);
-        auto miner = Miner::create(address, hashrate, std::move(share_handler), network);
+        auto share_handler = create_share_handler(behavior_name, behavior_params);
+        auto miner = Miner::create(address, hashrate, share_handler, network);
         miners.push_back(miner);
     }
     return miners;
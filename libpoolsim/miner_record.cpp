@@ -3,9 +3,9 @@
 
 namespace poolsim {
 
-MinerRecord::MinerRecord(std::string miner_address) : address(miner_address) {}
+MinerRecord::MinerRecord(Address miner_address) : address(miner_address) {}
 
-std::string MinerRecord::get_miner_address() const {
+Address MinerRecord::get_miner_address() const {
     return address;
 }
 
@@ -69,7 +69,7 @@ void MinerRecord::inc_shares_count() {
     shares_count++;
 }
 
-QBRecord::QBRecord(std::string miner_address) : MinerRecord(miner_address) {}
+QBRecord::QBRecord(Address miner_address) : MinerRecord(miner_address) {}
 
 void QBRecord::set_credits(uint64_t balance) {
     credits = balance;
@@ -99,4 +99,21 @@ void to_json(nlohmann::json& j, const MinerRecord& data) {
     };
 }
 
+void write_json(JSONWriter& writer, const MinerRecord& data) {
+    writer.start_object();
+    writer.key("blocks_mined");
+    writer.value(data.get_blocks_mined());
+    writer.key("blocks_received");
+    writer.value(data.get_blocks_received());
+    writer.key("miner_address");
+    writer.value(data.get_miner_address());
+    writer.key("share_count");
+    writer.value(data.get_shares_count());
+    writer.key("uncles_mined");
+    writer.value(data.get_uncles_mined());
+    writer.key("uncles_received");
+    writer.value(data.get_uncles_received());
+    writer.end_object();
+}
+
 }
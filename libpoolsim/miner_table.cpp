@@ -0,0 +1,23 @@
+#include "miner_table.h"
+#include "memory_usage.h"
+
+namespace poolsim {
+
+uint32_t MinerTable::add(const MinerState& state) {
+    states.push_back(state);
+    return static_cast<uint32_t>(states.size() - 1);
+}
+
+size_t MinerTable::size() const {
+    return states.size();
+}
+
+uint64_t MinerTable::get_memory_usage() const {
+    return poolsim::get_memory_usage(states);
+}
+
+void MinerTable::reserve(size_t count) {
+    states.reserve(count);
+}
+
+}
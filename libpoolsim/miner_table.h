@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace poolsim {
+
+class ShareHandler;
+
+// Constants needed to schedule the shares of a miner
+// They only depend on the hashrate, the pool difficulty and the network difficulty
+// so they are refreshed when the miner joins a pool or the difficulty changes
+struct SchedulingEntry {
+    // expected time between two shares of the miner (1 / lambda)
+    double share_interval = 0;
+    // probability that a share is a block, scaled to the range of a 64-bit uniform
+    uint64_t block_threshold = 0;
+};
+
+// State of a miner accessed every time it finds a share
+// Data only needed for the output (address, metadata) stays in Miner
+struct MinerState {
+    SchedulingEntry scheduling;
+    // difficulty of the pool the miner is currently in
+    uint64_t share_difficulty = 0;
+    uint64_t total_work = 0;
+    uint64_t blocks_found = 0;
+    double hashrate = 0;
+    // owned by the Miner, cached here to avoid going through it
+    ShareHandler* share_handler = nullptr;
+};
+
+// Contiguous storage for the hot state of miners
+// A miner ID is the index of its state in the table
+class MinerTable {
+public:
+    // Appends a state to the table and returns its ID
+    uint32_t add(const MinerState& state);
+
+    // Returns the state of the miner with the given ID
+    inline MinerState& operator[](uint32_t id) { return states[id]; }
+    inline const MinerState& operator[](uint32_t id) const { return states[id]; }
+
+    // Returns the number of miners in the table
+    size_t size() const;
+
+    // Returns the bytes held by the states
+    uint64_t get_memory_usage() const;
+
+    // Reserves space for the given number of miners
+    void reserve(size_t count);
+private:
+    std::vector<MinerState> states;
+};
+
+}
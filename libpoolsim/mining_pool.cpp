@@ -40,24 +40,32 @@ void MiningPool::set_reward_scheme(std::unique_ptr<RewardScheme> _reward_scheme)
     reward_scheme->set_mining_pool(shared_from_this());
 }
 
+RewardScheme& MiningPool::get_reward_scheme() const {
+    return *reward_scheme;
+}
+
 std::string MiningPool::get_scheme_name() const {
     return reward_scheme->get_scheme_name();
 }
 
-void MiningPool::join(const std::string& miner_address) {
+void MiningPool::join(Address miner_address) {
   miners.insert(miner_address);
 }
 
-void MiningPool::leave(const std::string& miner_address) {
+void MiningPool::leave(Address miner_address) {
     // NOTE: we still want to serialize the records later on
     // so we simply keep all the miners who have ever joined
     // the pool as part of it
 }
 
-std::set<std::string> MiningPool::get_miners() {
+const PoolMembership& MiningPool::get_miners() const {
   return miners;
 }
 
+bool MiningPool::has_miner(Address miner_address) const {
+  return miners.contains(miner_address);
+}
+
 std::shared_ptr<Network> MiningPool::get_network() const {
     return network.lock();
 }
@@ -82,9 +90,13 @@ uint64_t MiningPool::get_blocks_mined() const {
   return blocks_mined;
 }
 
+uint64_t MiningPool::get_shares_submitted() const {
+  return shares_submitted;
+}
+
 nlohmann::json MiningPool::get_miners_metadata() const {
     nlohmann::json result;
-    for (const std::string& address : miners) {
+    for (Address address : miners.get_sorted()) {
         nlohmann::json miner;
         miner["address"] = address;
         miner["metadata"] = reward_scheme->get_miner_metadata(address);
@@ -93,25 +105,29 @@ nlohmann::json MiningPool::get_miners_metadata() const {
     return result;
 }
 
-void MiningPool::submit_share(const std::string& miner_address, const Share& submitted_share) {
-    Share share = submitted_share;
-    if (share.is_valid_block() && random->drand48() < uncle_prob) {
-        share = Share(share.get_properties() | Share::Property::uncle);
-    }
-    if (share.is_network_share()) {
-        blocks_mined++;
+void MiningPool::write_miners_metadata(JSONWriter& writer, std::vector<uint64_t>* miner_offsets) const {
+    // an empty pool is serialized as null by get_miners_metadata
+    if (miners.size() == 0) {
+        writer.value(nullptr);
+        return;
     }
-    reward_scheme->handle_share(miner_address, share);
-    if (share.is_valid_block()) {
-        BlockEvent block_event {
-            .time = 0,
-            .is_uncle = share.is_uncle(),
-            .pool_name = pool_name,
-            .miner_address = miner_address,
-            .reward_scheme_data = reward_scheme->get_json_metadata()
-        };
-        notify(block_event);
+    writer.start_array();
+    for (Address address : miners.get_sorted()) {
+        if (miner_offsets != nullptr) {
+            miner_offsets->push_back(writer.get_offset());
+        }
+        writer.start_object();
+        writer.key("address");
+        writer.value(address);
+        writer.key("metadata");
+        reward_scheme->write_miner_metadata(writer, address);
+        writer.end_object();
     }
+    writer.end_array();
+}
+
+void MiningPool::submit_share(Address miner_address, const Share& share) {
+    submit_share<RewardScheme>(miner_address, share);
 }
 
 void to_json(nlohmann::json& j, const MiningPool& pool) {
@@ -121,4 +137,21 @@ void to_json(nlohmann::json& j, const MiningPool& pool) {
     j["miners"] = pool.get_miners_metadata();
 }
 
+void write_json(JSONWriter& writer, const MiningPool& pool, std::vector<uint64_t>* miner_offsets) {
+    writer.start_object();
+    write_json_fields(writer, pool, miner_offsets);
+    writer.end_object();
+}
+
+void write_json_fields(JSONWriter& writer, const MiningPool& pool, std::vector<uint64_t>* miner_offsets) {
+    writer.key("difficulty");
+    writer.value(pool.get_difficulty());
+    writer.key("miners");
+    pool.write_miners_metadata(writer, miner_offsets);
+    writer.key("name");
+    writer.value(pool.get_name());
+    writer.key("reward_scheme");
+    writer.value(pool.get_scheme_name());
+}
+
 }
@@ -24,4 +24,7 @@ void Network::set_current_time(uint64_t _current_time) { current_time = _current
 uint64_t Network::get_current_block() const { return current_block; }
 void Network::inc_current_block() { current_block++; }
 
+bool Network::records_hop_events() const { return record_hop_events; }
+void Network::set_record_hop_events(bool _record_hop_events) { record_hop_events = _record_hop_events; }
+
 }
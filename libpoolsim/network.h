@@ -4,13 +4,16 @@
 #include <vector>
 #include <cstdint>
 
+#include "observer.h"
 
 namespace poolsim {
 
 class MiningPool;
 class Simulator;
+struct HopEvent;
 
-class Network {
+// Miners hopping between pools are notified as HopEvent
+class Network : public Observable<HopEvent> {
 friend class Simulator;
 
 public:
@@ -20,10 +23,14 @@ public:
     uint64_t get_difficulty() const;
     uint64_t get_current_time() const;
     uint64_t get_current_block() const;
+    // Returns true if pool hopping miners should record their hops
+    bool records_hop_events() const;
+    void set_record_hop_events(bool record_hop_events);
 private:
     uint64_t difficulty;
     uint64_t current_time = 0;
     uint64_t current_block = 0;
+    bool record_hop_events = true;
     void inc_current_block();
     void set_difficulty(uint64_t difficulty);
     std::vector<std::shared_ptr<MiningPool>> pools;
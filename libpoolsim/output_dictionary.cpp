@@ -0,0 +1,61 @@
+#include "output_dictionary.h"
+#include "memory_usage.h"
+
+namespace poolsim {
+
+uint32_t PoolNameDictionary::get_id(const std::string& name) {
+    // simulations have few pools
+    uint32_t id = 0;
+    while (id < names.size() && names[id] != name) {
+        id++;
+    }
+    if (id == names.size()) {
+        names.push_back(name);
+    }
+    return id;
+}
+
+const std::vector<std::string>& PoolNameDictionary::get_names() const {
+    return names;
+}
+
+uint64_t PoolNameDictionary::get_memory_usage() const {
+    uint64_t bytes = poolsim::get_memory_usage(names);
+    for (const std::string& name : names) {
+        bytes += poolsim::get_memory_usage(name);
+    }
+    return bytes;
+}
+
+uint64_t OutputDictionary::get_memory_usage() const {
+    return pool_names.get_memory_usage() + addresses.get_memory_usage();
+}
+
+void write_pool_name(JSONWriter& writer, const char* name_key, const char* id_key,
+                     const std::string& name, OutputDictionary* dictionary) {
+    if (dictionary == nullptr) {
+        writer.key(name_key);
+        writer.value(name);
+        return;
+    }
+    writer.key(id_key);
+    writer.value(static_cast<uint64_t>(dictionary->pool_names.get_id(name)));
+}
+
+void write_address(JSONWriter& writer, const char* address_key, const char* id_key,
+                   Address address, OutputDictionary* dictionary) {
+    if (dictionary == nullptr) {
+        writer.key(address_key);
+        writer.value(address);
+        return;
+    }
+    writer.key(id_key);
+    uint32_t id = dictionary->addresses.get_id(address);
+    if (id == Address::null_id) {
+        writer.value(nullptr);
+    } else {
+        writer.value(static_cast<uint64_t>(id));
+    }
+}
+
+}
@@ -0,0 +1,166 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace poolsim {
+
+const char* get_perf_event_name(PerfEvent event) {
+    switch (event) {
+    case PerfEvent::cycles: return "cycles";
+    case PerfEvent::instructions: return "instructions";
+    case PerfEvent::l1d_misses: return "l1d_misses";
+    case PerfEvent::llc_misses: return "llc_misses";
+    case PerfEvent::branch_misses: return "branch_misses";
+    }
+    return "unknown";
+}
+
+bool PerfCounts::is_available(PerfEvent event) const {
+    return available[static_cast<size_t>(event)];
+}
+
+uint64_t PerfCounts::get(PerfEvent event) const {
+    return values[static_cast<size_t>(event)];
+}
+
+#ifdef __linux__
+
+static int open_event(PerfEvent event) {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (event) {
+    case PerfEvent::cycles:
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PerfEvent::instructions:
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PerfEvent::l1d_misses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case PerfEvent::llc_misses:
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PerfEvent::branch_misses:
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+    attr.disabled = 1;
+    // user space only, which is allowed with the default perf_event_paranoid
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfCounters::PerfCounters() {
+    for (size_t i = 0; i < perf_events_count; i++) {
+        fds[i] = open_event(static_cast<PerfEvent>(i));
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void PerfCounters::start() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void PerfCounters::stop() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+}
+
+PerfCounts PerfCounters::read() const {
+    PerfCounts counts;
+    for (size_t i = 0; i < perf_events_count; i++) {
+        // value, time enabled and time running
+        uint64_t data[3];
+        if (fds[i] < 0 || ::read(fds[i], data, sizeof(data)) != sizeof(data)) {
+            continue;
+        }
+        // a counter which never got a hardware counter was not counted at all, rather than 0 times
+        if (data[2] == 0) {
+            continue;
+        }
+        counts.available[i] = true;
+        if (data[2] < data[1]) {
+            counts.values[i] = static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+        } else {
+            counts.values[i] = data[0];
+        }
+    }
+    return counts;
+}
+
+#else
+
+PerfCounters::PerfCounters() {
+    for (size_t i = 0; i < perf_events_count; i++) {
+        fds[i] = -1;
+    }
+}
+
+PerfCounters::~PerfCounters() {}
+
+void PerfCounters::start() {}
+
+void PerfCounters::stop() {}
+
+PerfCounts PerfCounters::read() const {
+    return PerfCounts();
+}
+
+#endif
+
+bool PerfCounters::is_available() const {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void to_json(nlohmann::json& j, const PerfCounts& counts) {
+    j = nlohmann::json::object();
+    for (size_t i = 0; i < perf_events_count; i++) {
+        PerfEvent event = static_cast<PerfEvent>(i);
+        if (counts.is_available(event)) {
+            j[get_perf_event_name(event)] = counts.get(event);
+        } else {
+            j[get_perf_event_name(event)] = nullptr;
+        }
+    }
+    if (counts.is_available(PerfEvent::cycles) && counts.is_available(PerfEvent::instructions) &&
+            counts.get(PerfEvent::cycles) > 0) {
+        j["ipc"] = static_cast<double>(counts.get(PerfEvent::instructions)) / counts.get(PerfEvent::cycles);
+    } else {
+        j["ipc"] = nullptr;
+    }
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <nlohmann/json.hpp>
+
+namespace poolsim {
+
+// Hardware events counted by PerfCounters
+enum class PerfEvent : uint8_t {
+    cycles,
+    instructions,
+    // L1 data cache read misses
+    l1d_misses,
+    // last level cache misses
+    llc_misses,
+    branch_misses
+};
+
+const size_t perf_events_count = 5;
+
+// Returns the name of the event in the results
+const char* get_perf_event_name(PerfEvent event);
+
+// Values read from PerfCounters, events which could not be counted or were never scheduled are unavailable
+struct PerfCounts {
+    uint64_t values[perf_events_count] = {};
+    bool available[perf_events_count] = {};
+
+    bool is_available(PerfEvent event) const;
+    uint64_t get(PerfEvent event) const;
+};
+
+// Counts hardware events of the calling thread with perf_event_open
+// Each event is opened on its own, so that the others are still counted when the
+// kernel or the hardware refuses one of them (perf_event_paranoid, virtual machines)
+// Nothing is available outside of Linux.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(PerfCounters const&) = delete;
+    void operator=(PerfCounters const&) = delete;
+
+    // Returns true if at least one event can be counted
+    bool is_available() const;
+
+    // Resets and starts counting
+    void start();
+
+    // Stops counting, the counts can still be read
+    void stop();
+
+    // Counts since start, scaled when the kernel had to multiplex the events
+    PerfCounts read() const;
+
+private:
+    int fds[perf_events_count];
+};
+
+// Writes each event, null when unavailable, and the instructions per cycle
+void to_json(nlohmann::json& j, const PerfCounts& counts);
+
+}
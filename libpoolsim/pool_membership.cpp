@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "pool_membership.h"
+#include "memory_usage.h"
+
+namespace poolsim {
+
+static size_t hash_id(uint32_t id) {
+    return static_cast<size_t>((id * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+size_t PoolMembership::find_slot(uint32_t id) const {
+    size_t mask = index.size() - 1;
+    size_t slot = hash_id(id) & mask;
+    while (index[slot] != 0 && index[slot] != id + 1) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void PoolMembership::grow_index() {
+    index.assign(index.empty() ? 16 : 2 * index.size(), 0);
+    for (Address member : members) {
+        index[find_slot(member.get_id())] = member.get_id() + 1;
+    }
+}
+
+bool PoolMembership::insert(Address address) {
+    if (address.is_null()) {
+        throw std::invalid_argument("cannot add a null address to a pool");
+    }
+    if (contains(address)) {
+        return false;
+    }
+    members.push_back(address);
+    // keep the load factor under 1/2
+    if (2 * members.size() > index.size()) {
+        grow_index();
+    } else {
+        index[find_slot(address.get_id())] = address.get_id() + 1;
+    }
+    return true;
+}
+
+bool PoolMembership::contains(Address address) const {
+    if (index.empty() || address.is_null()) {
+        return false;
+    }
+    return index[find_slot(address.get_id())] != 0;
+}
+
+size_t PoolMembership::size() const {
+    return members.size();
+}
+
+uint64_t PoolMembership::get_memory_usage() const {
+    return poolsim::get_memory_usage(index) + poolsim::get_memory_usage(members);
+}
+
+std::vector<Address> PoolMembership::get_sorted() const {
+    std::vector<Address> sorted(members);
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+PoolMembership::const_iterator PoolMembership::begin() const {
+    return members.begin();
+}
+
+PoolMembership::const_iterator PoolMembership::end() const {
+    return members.end();
+}
+
+}
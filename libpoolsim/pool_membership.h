@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "address.h"
+
+namespace poolsim {
+
+// Set of the addresses which have joined a pool
+// Members are stored contiguously in the order in which they joined,
+// and found through an open addressing index of their address IDs,
+// so a pool only holds a few bytes per member whatever the number of
+// addresses in the simulation
+class PoolMembership {
+public:
+    typedef std::vector<Address>::const_iterator const_iterator;
+
+    // Adds the address to the members
+    // Returns false if it was already a member
+    bool insert(Address address);
+
+    // Returns true if the address is a member
+    bool contains(Address address) const;
+
+    // Returns the number of members
+    size_t size() const;
+
+    // Returns the bytes held by the index and the members
+    uint64_t get_memory_usage() const;
+
+    // Returns the members in address order, the order in which results list them
+    std::vector<Address> get_sorted() const;
+
+    // Iterates over the members in join order
+    const_iterator begin() const;
+    const_iterator end() const;
+private:
+    // Returns the slot of the index holding the address, or the empty slot where it goes
+    size_t find_slot(uint32_t id) const;
+
+    // Doubles the size of the index
+    void grow_index();
+
+    // address ID + 1 of the members, 0 for empty slots, at most half full
+    std::vector<uint32_t> index;
+    std::vector<Address> members;
+};
+
+}
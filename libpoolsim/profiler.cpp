@@ -0,0 +1,48 @@
+#include "profiler.h"
+
+namespace poolsim {
+
+Profiler Profiler::instance;
+
+const char* get_phase_name(ProfilePhase phase) {
+    switch (phase) {
+    case ProfilePhase::run: return "run";
+    case ProfilePhase::event_pop: return "event_pop";
+    case ProfilePhase::scheduling: return "scheduling";
+    case ProfilePhase::random: return "random";
+    case ProfilePhase::share_handler: return "share_handler";
+    case ProfilePhase::reward_scheme: return "reward_scheme";
+    case ProfilePhase::block_notification: return "block_notification";
+    case ProfilePhase::output: return "output";
+    }
+    return "unknown";
+}
+
+Profiler& Profiler::get_instance() {
+    return instance;
+}
+
+void Profiler::reset() {
+    for (PhaseProfile& phase : phases) {
+        phase = PhaseProfile();
+    }
+}
+
+const PhaseProfile& Profiler::get_phase(ProfilePhase phase) const {
+    return phases[static_cast<size_t>(phase)];
+}
+
+void to_json(nlohmann::json& j, const Profiler& profiler) {
+    j = nlohmann::json::object();
+    for (size_t i = 0; i < profile_phases_count; i++) {
+        ProfilePhase phase = static_cast<ProfilePhase>(i);
+        const PhaseProfile& profile = profiler.get_phase(phase);
+        j[get_phase_name(phase)] = {
+            {"calls", profile.calls},
+            {"total_nanoseconds", profile.total_nanoseconds},
+            {"self_nanoseconds", profile.self_nanoseconds}
+        };
+    }
+}
+
+}
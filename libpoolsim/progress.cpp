@@ -0,0 +1,126 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "progress.h"
+
+namespace poolsim {
+
+uint64_t get_current_rss_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident)) {
+        return 0;
+    }
+    return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+uint64_t get_peak_rss_bytes() {
+    // ru_maxrss also covers the pages of the parent shared before exec, VmHWM only this program
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        unsigned long kilobytes = 0;
+        if (std::sscanf(line.c_str(), "VmHWM: %lu kB", &kilobytes) == 1) {
+            return static_cast<uint64_t>(kilobytes) * 1024;
+        }
+    }
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    // in kilobytes on Linux
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+static double get_seconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(duration).count();
+}
+
+ProgressReporter::ProgressReporter(const std::string& _destination, double interval_seconds)
+    : destination(_destination) {
+    if (interval_seconds <= 0) {
+        throw std::invalid_argument("progress interval should be greater than 0");
+    }
+    interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(interval_seconds));
+    start = std::chrono::steady_clock::now();
+    last_report = start;
+    next_report = start + interval;
+}
+
+nlohmann::json ProgressReporter::get_report(const ProgressStatus& status,
+                                            std::chrono::steady_clock::time_point now) const {
+    double elapsed = get_seconds(now - start);
+    double since_last_report = get_seconds(now - last_report);
+    uint64_t rss = get_current_rss_bytes();
+    nlohmann::json report = {
+        {"type", "progress"},
+        {"done", status.done},
+        {"elapsed_seconds", elapsed},
+        {"blocks", status.blocks},
+        {"target_blocks", status.target_blocks},
+        {"events", status.events},
+        {"shares", status.shares},
+        {"queue_size", status.queue_size},
+        {"rss_bytes", rss},
+        // both are sampled differently by the kernel
+        {"peak_rss_bytes", std::max(rss, get_peak_rss_bytes())}
+    };
+    report["events_per_second"] = since_last_report > 0
+        ? nlohmann::json((status.events - last_events) / since_last_report) : nlohmann::json(nullptr);
+    report["average_events_per_second"] = elapsed > 0
+        ? nlohmann::json(status.events / elapsed) : nlohmann::json(nullptr);
+    report["shares_per_second"] = since_last_report > 0
+        ? nlohmann::json((status.shares - last_shares) / since_last_report) : nlohmann::json(nullptr);
+    report["average_shares_per_second"] = elapsed > 0
+        ? nlohmann::json(status.shares / elapsed) : nlohmann::json(nullptr);
+    // blocks are found at a steady rate, so the average over the whole run is the best estimate
+    if (status.done) {
+        report["eta_seconds"] = 0.0;
+    } else if (status.blocks > 0 && status.target_blocks >= status.blocks) {
+        report["eta_seconds"] = elapsed * (status.target_blocks - status.blocks) / status.blocks;
+    } else {
+        report["eta_seconds"] = nullptr;
+    }
+    return report;
+}
+
+void ProgressReporter::report(const ProgressStatus& status) {
+    auto now = std::chrono::steady_clock::now();
+    write(get_report(status, now).dump());
+    last_report = now;
+    last_events = status.events;
+    last_shares = status.shares;
+    next_report = now + interval;
+}
+
+void ProgressReporter::write(const std::string& line) const {
+    if (destination == "-") {
+        std::cerr << line << std::endl;
+        return;
+    }
+    // rename replaces the file atomically, readers see either report but never a partial one
+    std::string temporary_filepath = destination + ".tmp";
+    {
+        std::ofstream file(temporary_filepath);
+        file << line << "\n";
+        if (!file) {
+            throw std::invalid_argument("cannot write " + temporary_filepath);
+        }
+    }
+    if (std::rename(temporary_filepath.c_str(), destination.c_str()) != 0) {
+        throw std::invalid_argument("cannot replace " + destination);
+    }
+}
+
+}
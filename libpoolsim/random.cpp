@@ -1,6 +1,6 @@
 #include "random.h"
+#include "profiler.h"
 
-#include <sstream>
 
 namespace poolsim {
 
@@ -13,26 +13,34 @@ const char* RandomInitException::what() const throw() {
 
 RandomInitException::RandomInitException(const char* _message): message(_message) {}
 
+uint64_t Random::random_uint64() {
+  // drand48() returns x / 2^48 for a 48-bit integer x, so this is exact
+  return static_cast<uint64_t>(drand48() * 281474976710656.0) << 16;
+}
+
 SystemRandom::SystemRandom() :
   random_engine(std::make_shared<std::default_random_engine>()) {}
 
 double SystemRandom::drand48() {
+  POOLSIM_PROFILE_SCOPE(random);
   return ::drand48();
 }
 
 int SystemRandom::random_int(int min, int max) {
+    POOLSIM_PROFILE_SCOPE(random);
     std::uniform_int_distribution<int> dist(min, max);
     return dist(*get_random_engine());
 }
 
-std::string SystemRandom::get_address() {
-  std::stringstream result;
+Address SystemRandom::get_address() {
+  AddressBytes bytes;
   std::uniform_int_distribution<int> dist(0, 15);
-  for (size_t i = 0; i < 40; i++) {
-    auto value = dist(*get_random_engine());
-    result << std::hex << value;
+  for (size_t i = 0; i < bytes.size(); i++) {
+    int high = dist(*get_random_engine());
+    int low = dist(*get_random_engine());
+    bytes[i] = static_cast<uint8_t>((high << 4) | low);
   }
-  return "0x" + result.str();
+  return Address(bytes);
 }
 
 std::shared_ptr<std::default_random_engine> SystemRandom::get_random_engine() {
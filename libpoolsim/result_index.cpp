@@ -0,0 +1,187 @@
+#include <fstream>
+#include <cctype>
+#include <stdexcept>
+
+#include "result_index.h"
+#include "tracer.h"
+
+namespace poolsim {
+
+std::string get_index_filepath(const std::string& results_filepath) {
+    return results_filepath + ".idx";
+}
+
+ResultIndexWriter::ResultIndexWriter(ResultFormat _format) : format(_format) {}
+
+void ResultIndexWriter::add_pool(const std::string& name, uint64_t difficulty) {
+    pool_names.push_back(name);
+    pool_difficulties.push_back(difficulty);
+}
+
+uint32_t ResultIndexWriter::get_pools_count() const {
+    return pool_names.size();
+}
+
+void ResultIndexWriter::add_miner(Address address, uint64_t position) {
+    entries[address.to_string()].miner_position = position;
+}
+
+void ResultIndexWriter::add_pool_miner(uint32_t pool_id, Address address, uint64_t position) {
+    entries[address.to_string()].pools.push_back(std::make_pair(pool_id, position));
+}
+
+void ResultIndexWriter::write(const std::string& filepath) const {
+    TraceSpan span("output", "write_index");
+    std::vector<uint8_t> formats = {static_cast<uint8_t>(format)};
+    std::vector<std::string> addresses;
+    std::vector<uint64_t> miner_positions;
+    // entries of the address i are between pool_starts[i] and pool_starts[i + 1]
+    std::vector<uint64_t> pool_starts = {0};
+    std::vector<uint32_t> pool_ids;
+    std::vector<uint64_t> pool_positions;
+    for (const auto& entry : entries) {
+        addresses.push_back(entry.first);
+        miner_positions.push_back(entry.second.miner_position);
+        for (const auto& pool : entry.second.pools) {
+            pool_ids.push_back(pool.first);
+            pool_positions.push_back(pool.second);
+        }
+        pool_starts.push_back(pool_ids.size());
+    }
+
+    ColumnarWriter writer;
+    writer.add_column("format", formats);
+    writer.add_string_column("addresses", addresses);
+    writer.add_column("miners.position", miner_positions);
+    writer.add_column("pool_miners.start", pool_starts);
+    writer.add_column("pool_miners.pool_id", pool_ids);
+    writer.add_column("pool_miners.position", pool_positions);
+    writer.add_string_column("pools.name", pool_names);
+    writer.add_column("pools.difficulty", pool_difficulties);
+    writer.write(filepath);
+}
+
+ResultIndex::ResultIndex(const std::string& filepath) : reader(filepath) {}
+
+ResultFormat ResultIndex::get_format() const {
+    return static_cast<ResultFormat>(reader.get_column<uint8_t>("format")[0]);
+}
+
+bool ResultIndex::find(const std::string& address, IndexedMiner& miner) const {
+    auto addresses = reader.get_string_column("addresses");
+    size_t low = 0, high = addresses.size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (addresses[middle] < address) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == addresses.size() || addresses[low] != address) {
+        return false;
+    }
+
+    auto pool_starts = reader.get_column<uint64_t>("pool_miners.start");
+    auto pool_ids = reader.get_column<uint32_t>("pool_miners.pool_id");
+    auto pool_positions = reader.get_column<uint64_t>("pool_miners.position");
+    miner.miner_position = reader.get_column<uint64_t>("miners.position")[low];
+    miner.pools.clear();
+    for (uint64_t i = pool_starts[low]; i < pool_starts[low + 1]; i++) {
+        miner.pools.push_back(std::make_pair(pool_ids[i], pool_positions[i]));
+    }
+    return true;
+}
+
+std::string ResultIndex::get_pool_name(uint32_t pool_id) const {
+    return reader.get_string_column("pools.name")[pool_id];
+}
+
+uint64_t ResultIndex::get_pool_difficulty(uint32_t pool_id) const {
+    return reader.get_column<uint64_t>("pools.difficulty")[pool_id];
+}
+
+// Reads the JSON value written at the given offset of the results
+static nlohmann::json read_json_at(std::ifstream& input, uint64_t offset) {
+    input.clear();
+    input.seekg(offset);
+    // offsets are taken before the separator of array elements
+    while (input && (input.peek() == ',' || std::isspace(input.peek()))) {
+        input.get();
+    }
+    nlohmann::json value;
+    input >> value;
+    return value;
+}
+
+// Results of a miner in a pool
+struct PoolMinerResult {
+    uint64_t blocks_mined;
+    double blocks_received;
+    uint64_t share_count;
+};
+
+MinerInfo query_miner_info(const std::string& results_filepath, const std::string& address) {
+    ResultIndex index(get_index_filepath(results_filepath));
+    IndexedMiner miner;
+    if (!index.find(address, miner) || miner.miner_position == no_result_position) {
+        throw std::invalid_argument("miner " + address + " does not exist");
+    }
+    if (miner.pools.empty()) {
+        throw std::invalid_argument("miner " + address + " not in any pool");
+    }
+
+    uint64_t total_work = 0;
+    std::vector<PoolMinerResult> pool_results;
+    if (index.get_format() == ResultFormat::columnar) {
+        ColumnarReader results(results_filepath);
+        total_work = results.get_column<uint64_t>("miners.total_work")[miner.miner_position];
+        auto blocks_mined = results.get_column<uint64_t>("pool_miners.blocks_mined");
+        auto blocks_received = results.get_column<double>("pool_miners.blocks_received");
+        auto share_counts = results.get_column<uint64_t>("pool_miners.share_count");
+        for (const auto& pool : miner.pools) {
+            pool_results.push_back(PoolMinerResult {
+                blocks_mined[pool.second], blocks_received[pool.second], share_counts[pool.second]
+            });
+        }
+    } else {
+        std::ifstream results(results_filepath, std::ios_base::in | std::ios_base::binary);
+        if (!results) {
+            throw std::invalid_argument("cannot open " + results_filepath);
+        }
+        total_work = read_json_at(results, miner.miner_position).at("total_work");
+        for (const auto& pool : miner.pools) {
+            auto metadata = read_json_at(results, pool.second).at("metadata");
+            pool_results.push_back(PoolMinerResult {
+                metadata.at("blocks_mined"), metadata.at("blocks_received"), metadata.at("share_count")
+            });
+        }
+    }
+
+    MinerInfo info;
+    for (size_t i = 0; i < miner.pools.size(); i++) {
+        const PoolMinerResult& result = pool_results[i];
+        uint32_t pool_id = miner.pools[i].first;
+        info.blocks_mined += result.blocks_mined;
+        info.blocks_received += result.blocks_received;
+        info.work_in_pool_per_block[index.get_pool_name(pool_id)] =
+            result.share_count * (double)index.get_pool_difficulty(pool_id) / result.blocks_received;
+    }
+    info.blocks_ratio = info.blocks_received / info.blocks_mined;
+    info.work_per_block = total_work / info.blocks_received;
+    info.work_per_block_solo = total_work / (double)info.blocks_mined;
+    return info;
+}
+
+void to_json(nlohmann::json& j, const MinerInfo& info) {
+    j = nlohmann::json{
+        {"blocks_mined", info.blocks_mined},
+        {"blocks_received", info.blocks_received},
+        {"blocks_ratio", info.blocks_ratio},
+        {"work_per_block", info.work_per_block},
+        {"work_in_pool_per_block", info.work_in_pool_per_block},
+        {"work_per_block_solo", info.work_per_block_solo}
+    };
+}
+
+}
@@ -0,0 +1,538 @@
+#include <fstream>
+#include <stdexcept>
+
+#include "result_writer.h"
+#include "columnar.h"
+#include "gzip_stream.h"
+#include "result_index.h"
+
+namespace poolsim {
+
+using nlohmann::json;
+
+static bool ends_with(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size()
+        && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::unique_ptr<std::ostream> open_output_file(const std::string& filepath) {
+    // FIXME: throw if the filepath does not exist or create it
+    if (!ends_with(filepath, ".gz")) {
+        return std::unique_ptr<std::ostream>(new std::ofstream(
+            filepath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc));
+    }
+    return std::unique_ptr<std::ostream>(new GzipOutputStream(filepath));
+}
+
+// Flushes the output and, for gzip files, completes them so that errors are reported
+static void close_output_file(std::unique_ptr<std::ostream>& output) {
+    output->flush();
+    GzipOutputStream* gzip_output = dynamic_cast<GzipOutputStream*>(output.get());
+    if (gzip_output != nullptr) {
+        gzip_output->close();
+    }
+    output.reset();
+}
+
+// Compressed results cannot be read from an offset, so they are not indexed
+static bool is_indexed(const std::string& filepath) {
+    return !ends_with(filepath, ".gz");
+}
+
+// Adds the miners of a pool to the index, positions being in the order in which they are written
+static void add_pool_to_index(ResultIndexWriter& index, const MiningPool& pool,
+                              const std::vector<uint64_t>& positions) {
+    uint32_t pool_id = index.get_pools_count();
+    index.add_pool(pool.get_name(), pool.get_difficulty());
+    size_t i = 0;
+    for (Address address : pool.get_miners().get_sorted()) {
+        index.add_pool_miner(pool_id, address, positions[i++]);
+    }
+}
+
+// Returns true if the block has a receiver address to encode
+static bool has_receiver(const BlockEvent& block_event, uint8_t block_fields) {
+    return (block_fields & BlockField::reward_scheme_data)
+        && block_event.reward_scheme_data != nullptr
+        && block_event.reward_scheme_data_type == BlockDataType::qb;
+}
+
+static Address get_receiver(const BlockEvent& block_event) {
+    return static_cast<const QBBlockMetaData&>(*block_event.reward_scheme_data).receiver_address;
+}
+
+ResultWriter::~ResultWriter() {}
+
+void ResultWriter::write_hop(const HopEvent& hop_event) {}
+
+void ResultWriter::write_snapshot(const PoolSnapshot& snapshot) {}
+
+void ResultWriter::write_profile(const Profiler& profiler) {
+    profile = profiler;
+}
+
+void ResultWriter::write_perf_counters(const PerfCounts& counts) {
+    perf_counters = counts;
+}
+
+void ResultWriter::write_peak_rss(uint64_t bytes) {
+    peak_rss_bytes = bytes;
+}
+
+void ResultWriter::add_memory_usage(MemoryUsage& usage) const {}
+
+std::unique_ptr<ResultWriter> ResultWriter::create(const std::string& filepath, bool compact,
+                                                   uint8_t block_fields, bool dictionary_encoding) {
+    if (ends_with(filepath, ".ndjson") || ends_with(filepath, ".ndjson.gz")) {
+        return std::unique_ptr<ResultWriter>(
+            new NDJSONResultWriter(filepath, block_fields, dictionary_encoding));
+    }
+    if (ends_with(filepath, ".psim")) {
+        return std::unique_ptr<ResultWriter>(new ColumnarResultWriter(filepath, block_fields));
+    }
+    return std::unique_ptr<ResultWriter>(
+        new JSONResultWriter(filepath, compact, block_fields, dictionary_encoding));
+}
+
+JSONResultWriter::JSONResultWriter(const std::string& _filepath, bool compact, uint8_t _block_fields,
+                                   bool dictionary_encoding)
+    : filepath(_filepath), output(open_output_file(filepath)),
+      writer(new JSONWriter(*output, compact ? -1 : 4)),
+      block_fields(_block_fields),
+      dictionary(dictionary_encoding ? new OutputDictionary() : nullptr) {
+    writer->start_object();
+    writer->key("blocks");
+    writer->start_array();
+}
+
+void JSONResultWriter::write_block(const BlockEvent& block_event) {
+    write_json(*writer, block_event, block_fields, dictionary.get());
+}
+
+void JSONResultWriter::add_memory_usage(MemoryUsage& usage) const {
+    if (dictionary) {
+        usage["output_dictionary"] += dictionary->get_memory_usage();
+    }
+}
+
+void JSONResultWriter::finish(int64_t runtime_milliseconds,
+                              const std::vector<std::shared_ptr<MiningPool>>& pools,
+                              const std::vector<std::shared_ptr<Miner>>& miners) {
+    writer->end_array();
+
+    if (dictionary) {
+        // the hop events of the miners refer to pools which may have found no block
+        for (auto pool : pools) {
+            dictionary->pool_names.get_id(pool->get_name());
+        }
+        writer->key("dictionary");
+        writer->start_object();
+        writer->key("addresses");
+        writer->start_array();
+        for (Address address : dictionary->addresses.get_addresses()) {
+            writer->value(address);
+        }
+        writer->end_array();
+        writer->key("pool_names");
+        writer->start_array();
+        for (const std::string& name : dictionary->pool_names.get_names()) {
+            writer->value(name);
+        }
+        writer->end_array();
+        writer->end_object();
+    }
+
+    ResultIndexWriter index(ResultFormat::json);
+    writer->key("miners");
+    writer->start_array();
+    for (auto miner : miners) {
+        index.add_miner(miner->get_address(), writer->get_offset());
+        write_json(*writer, *miner, dictionary.get());
+    }
+    writer->end_array();
+
+    writer->key("pools");
+    writer->start_array();
+    std::vector<uint64_t> miner_offsets;
+    for (auto pool : pools) {
+        miner_offsets.clear();
+        write_json(*writer, *pool, &miner_offsets);
+        add_pool_to_index(index, *pool, miner_offsets);
+    }
+    writer->end_array();
+
+    if (!peak_rss_bytes.is_null()) {
+        writer->key("peak_rss_bytes");
+        writer->value(peak_rss_bytes);
+    }
+    if (!perf_counters.is_null()) {
+        writer->key("perf_counters");
+        writer->value(perf_counters);
+    }
+    if (!profile.is_null()) {
+        writer->key("profile");
+        writer->value(profile);
+    }
+    writer->key("runtime_milliseconds");
+    writer->value(runtime_milliseconds);
+    writer->end_object();
+    writer->raw("\n");
+    writer->flush();
+    writer.reset();
+    close_output_file(output);
+    if (is_indexed(filepath)) {
+        index.write(get_index_filepath(filepath));
+    }
+}
+
+NDJSONResultWriter::NDJSONResultWriter(const std::string& _filepath, uint8_t _block_fields,
+                                       bool dictionary_encoding)
+    : filepath(_filepath), output(open_output_file(filepath)), writer(new JSONWriter(*output)),
+      block_fields(_block_fields),
+      dictionary(dictionary_encoding ? new OutputDictionary() : nullptr) {}
+
+uint32_t NDJSONResultWriter::encode(const std::string& pool_name) {
+    size_t count = dictionary->pool_names.get_names().size();
+    uint32_t id = dictionary->pool_names.get_id(pool_name);
+    if (id == count) {
+        writer->start_object();
+        writer->key("type");
+        writer->value("pool_name");
+        writer->key("id");
+        writer->value(static_cast<uint64_t>(id));
+        writer->key("value");
+        writer->value(pool_name);
+        writer->end_object();
+        writer->raw("\n");
+    }
+    return id;
+}
+
+uint32_t NDJSONResultWriter::encode(Address address) {
+    size_t count = dictionary->addresses.get_addresses().size();
+    uint32_t id = dictionary->addresses.get_id(address);
+    if (id == count) {
+        writer->start_object();
+        writer->key("type");
+        writer->value("address");
+        writer->key("id");
+        writer->value(static_cast<uint64_t>(id));
+        writer->key("value");
+        writer->value(address);
+        writer->end_object();
+        writer->raw("\n");
+    }
+    return id;
+}
+
+void NDJSONResultWriter::write_block(const BlockEvent& block_event) {
+    if (dictionary) {
+        // definitions must come before the block line
+        if (block_fields & BlockField::pool_name) {
+            encode(*block_event.pool_name);
+        }
+        if (block_fields & BlockField::miner_address) {
+            encode(block_event.miner_address);
+        }
+        if (has_receiver(block_event, block_fields)) {
+            encode(get_receiver(block_event));
+        }
+    }
+    writer->start_object();
+    writer->key("type");
+    writer->value("block");
+    write_json_fields(*writer, block_event, block_fields, dictionary.get());
+    writer->end_object();
+    writer->raw("\n");
+}
+
+void NDJSONResultWriter::write_hop(const HopEvent& hop_event) {
+    if (dictionary) {
+        encode(hop_event.miner_address);
+        encode(hop_event.next_pool);
+        encode(hop_event.previous_pool);
+    }
+    writer->start_object();
+    writer->key("type");
+    writer->value("hop");
+    write_address(*writer, "miner_address", "miner_id", hop_event.miner_address, dictionary.get());
+    write_pool_name(*writer, "next_pool", "next_pool_id", hop_event.next_pool, dictionary.get());
+    write_pool_name(*writer, "previous_pool", "previous_pool_id", hop_event.previous_pool, dictionary.get());
+    writer->key("time");
+    writer->value(hop_event.time);
+    writer->end_object();
+    writer->raw("\n");
+}
+
+void NDJSONResultWriter::write_snapshot(const PoolSnapshot& snapshot) {
+    if (dictionary) {
+        encode(snapshot.pool_name);
+    }
+    writer->start_object();
+    writer->key("type");
+    writer->value("snapshot");
+    writer->key("block");
+    writer->value(snapshot.block);
+    writer->key("blocks_mined");
+    writer->value(snapshot.blocks_mined);
+    writer->key("luck");
+    writer->value(snapshot.luck);
+    writer->key("miners_count");
+    writer->value(snapshot.miners_count);
+    write_pool_name(*writer, "pool_name", "pool_id", snapshot.pool_name, dictionary.get());
+    writer->key("time");
+    writer->value(snapshot.time);
+    writer->end_object();
+    writer->raw("\n");
+}
+
+void NDJSONResultWriter::add_memory_usage(MemoryUsage& usage) const {
+    if (dictionary) {
+        usage["output_dictionary"] += dictionary->get_memory_usage();
+    }
+}
+
+void NDJSONResultWriter::finish(int64_t runtime_milliseconds,
+                                const std::vector<std::shared_ptr<MiningPool>>& pools,
+                                const std::vector<std::shared_ptr<Miner>>& miners) {
+    ResultIndexWriter index(ResultFormat::ndjson);
+    std::vector<uint64_t> miner_offsets;
+    if (dictionary) {
+        // the hop events of the miners refer to pools which may have found no block
+        for (auto pool : pools) {
+            encode(pool->get_name());
+        }
+    }
+    for (auto pool : pools) {
+        miner_offsets.clear();
+        writer->start_object();
+        writer->key("type");
+        writer->value("pool");
+        write_json_fields(*writer, *pool, &miner_offsets);
+        writer->end_object();
+        writer->raw("\n");
+        add_pool_to_index(index, *pool, miner_offsets);
+    }
+    for (auto miner : miners) {
+        index.add_miner(miner->get_address(), writer->get_offset());
+        writer->start_object();
+        writer->key("type");
+        writer->value("miner");
+        write_json_fields(*writer, *miner, dictionary.get());
+        writer->end_object();
+        writer->raw("\n");
+    }
+    writer->start_object();
+    writer->key("type");
+    writer->value("summary");
+    if (!peak_rss_bytes.is_null()) {
+        writer->key("peak_rss_bytes");
+        writer->value(peak_rss_bytes);
+    }
+    if (!perf_counters.is_null()) {
+        writer->key("perf_counters");
+        writer->value(perf_counters);
+    }
+    if (!profile.is_null()) {
+        writer->key("profile");
+        writer->value(profile);
+    }
+    writer->key("runtime_milliseconds");
+    writer->value(runtime_milliseconds);
+    writer->end_object();
+    writer->raw("\n");
+    writer->flush();
+    writer.reset();
+    close_output_file(output);
+    if (is_indexed(filepath)) {
+        index.write(get_index_filepath(filepath));
+    }
+}
+
+ColumnarResultWriter::ColumnarResultWriter(const std::string& _filepath, uint8_t _block_fields)
+    : filepath(_filepath), block_fields(_block_fields) {}
+
+void ColumnarResultWriter::write_block(const BlockEvent& block_event) {
+    if (block_fields & BlockField::time) {
+        block_times.push_back(block_event.time);
+    }
+    if (block_fields & BlockField::is_uncle) {
+        block_uncles.push_back(block_event.is_uncle);
+    }
+    if (block_fields & BlockField::pool_name) {
+        block_pool_ids.push_back(event_pool_names.get_id(*block_event.pool_name));
+    }
+    if (block_fields & BlockField::miner_address) {
+        block_miner_ids.push_back(addresses.get_id(block_event.miner_address));
+    }
+    if (!(block_fields & BlockField::reward_scheme_data)) {
+        return;
+    }
+
+    QBBlockMetaData data;
+    if (block_event.reward_scheme_data == nullptr) {
+        // keep the defaults
+    } else if (block_event.reward_scheme_data_type == BlockDataType::qb) {
+        data = static_cast<const QBBlockMetaData&>(*block_event.reward_scheme_data);
+    } else {
+        static_cast<BlockMetaData&>(data) = *block_event.reward_scheme_data;
+    }
+
+    block_data_types.push_back(static_cast<uint8_t>(block_event.reward_scheme_data_type));
+    block_shares.push_back(data.shares_per_block);
+    block_pool_luck.push_back(data.pool_luck);
+    block_receiver_ids.push_back(addresses.get_id(data.receiver_address));
+    block_credit_balances.push_back(data.credit_balance_receiver);
+    block_reset_balances.push_back(data.reset_balance_receiver);
+    block_prop_credits_lost.push_back(data.prop_credits_lost);
+    block_total_credits_lost.push_back(data.total_credits_lost);
+    block_average_credits_lost.push_back(data.average_credits_lost);
+}
+
+void ColumnarResultWriter::write_hop(const HopEvent& hop_event) {
+    hop_times.push_back(hop_event.time);
+    hop_miner_ids.push_back(addresses.get_id(hop_event.miner_address));
+    hop_previous_pool_ids.push_back(event_pool_names.get_id(hop_event.previous_pool));
+    hop_next_pool_ids.push_back(event_pool_names.get_id(hop_event.next_pool));
+}
+
+void ColumnarResultWriter::add_memory_usage(MemoryUsage& usage) const {
+    usage["output_columns"] += get_memory_usage(block_times) + get_memory_usage(block_uncles) +
+        get_memory_usage(block_pool_ids) + get_memory_usage(block_miner_ids) +
+        get_memory_usage(block_data_types) + get_memory_usage(block_shares) +
+        get_memory_usage(block_pool_luck) + get_memory_usage(block_receiver_ids) +
+        get_memory_usage(block_credit_balances) + get_memory_usage(block_reset_balances) +
+        get_memory_usage(block_prop_credits_lost) + get_memory_usage(block_total_credits_lost) +
+        get_memory_usage(block_average_credits_lost) + get_memory_usage(hop_times) +
+        get_memory_usage(hop_miner_ids) + get_memory_usage(hop_previous_pool_ids) +
+        get_memory_usage(hop_next_pool_ids);
+    usage["output_dictionary"] += addresses.get_memory_usage() + event_pool_names.get_memory_usage();
+}
+
+void ColumnarResultWriter::finish(int64_t runtime_milliseconds,
+                                  const std::vector<std::shared_ptr<MiningPool>>& pools,
+                                  const std::vector<std::shared_ptr<Miner>>& miners) {
+    // event pool IDs refer to the order of first appearance until now
+    std::vector<uint32_t> pool_ids;
+    for (const std::string& name : event_pool_names.get_names()) {
+        uint32_t pool_id = 0;
+        while (pool_id < pools.size() && pools[pool_id]->get_name() != name) {
+            pool_id++;
+        }
+        pool_ids.push_back(pool_id);
+    }
+    for (auto event_pool_ids : {&block_pool_ids, &hop_previous_pool_ids, &hop_next_pool_ids}) {
+        for (uint32_t& pool_id : *event_pool_ids) {
+            pool_id = pool_ids[pool_id];
+        }
+    }
+
+    std::vector<std::string> pool_names, pool_schemes;
+    std::vector<uint64_t> pool_difficulties;
+    std::vector<uint32_t> member_pool_ids, member_address_ids;
+    std::vector<uint64_t> member_blocks_mined, member_uncles_mined, member_shares;
+    std::vector<double> member_blocks_received, member_uncles_received;
+    // positions in the index are row IDs
+    ResultIndexWriter index(ResultFormat::columnar);
+    for (uint32_t pool_id = 0; pool_id < pools.size(); pool_id++) {
+        auto pool = pools[pool_id];
+        pool_names.push_back(pool->get_name());
+        pool_schemes.push_back(pool->get_scheme_name());
+        pool_difficulties.push_back(pool->get_difficulty());
+        index.add_pool(pool->get_name(), pool->get_difficulty());
+        for (Address address : pool->get_miners().get_sorted()) {
+            auto record = pool->get_reward_scheme().get_record(address);
+            index.add_pool_miner(pool_id, address, member_pool_ids.size());
+            member_pool_ids.push_back(pool_id);
+            member_address_ids.push_back(addresses.get_id(address));
+            member_blocks_mined.push_back(record->get_blocks_mined());
+            member_blocks_received.push_back(record->get_blocks_received());
+            member_uncles_mined.push_back(record->get_uncles_mined());
+            member_uncles_received.push_back(record->get_uncles_received());
+            member_shares.push_back(record->get_shares_count());
+        }
+    }
+
+    std::vector<uint32_t> miner_address_ids;
+    std::vector<std::string> miner_behaviors, miner_metadata;
+    std::vector<double> miner_hashrates;
+    std::vector<uint64_t> miner_blocks_found, miner_total_work;
+    for (auto miner : miners) {
+        index.add_miner(miner->get_address(), miner_address_ids.size());
+        miner_address_ids.push_back(addresses.get_id(miner->get_address()));
+        miner_behaviors.push_back(miner->get_handler_name());
+        miner_metadata.push_back(miner->get_handler_metadata().dump());
+        miner_hashrates.push_back(miner->get_hashrate());
+        miner_blocks_found.push_back(miner->get_blocks_found());
+        miner_total_work.push_back(miner->get_total_work());
+    }
+
+    std::vector<std::string> address_strings;
+    for (Address address : addresses.get_addresses()) {
+        address_strings.push_back(address.to_string());
+    }
+    std::vector<uint64_t> runtime = {static_cast<uint64_t>(runtime_milliseconds)};
+    std::vector<std::string> profiles = {profile.dump()};
+    std::vector<std::string> perf_counters_rows = {perf_counters.dump()};
+
+    ColumnarWriter writer;
+    writer.add_column("runtime_milliseconds", runtime);
+    if (!profile.is_null()) {
+        // single row with the profile as JSON
+        writer.add_string_column("profile", profiles);
+    }
+    if (!perf_counters.is_null()) {
+        writer.add_string_column("perf_counters", perf_counters_rows);
+    }
+    if (!peak_rss_bytes.is_null()) {
+        writer.add_column("peak_rss_bytes", std::vector<uint64_t>{peak_rss_bytes.get<uint64_t>()});
+    }
+    writer.add_string_column("addresses", address_strings);
+    if (block_fields & BlockField::time) {
+        writer.add_column("blocks.time", block_times);
+    }
+    if (block_fields & BlockField::is_uncle) {
+        writer.add_column("blocks.is_uncle", block_uncles);
+    }
+    if (block_fields & BlockField::pool_name) {
+        writer.add_column("blocks.pool_id", block_pool_ids);
+    }
+    if (block_fields & BlockField::miner_address) {
+        writer.add_column("blocks.miner_id", block_miner_ids);
+    }
+    if (block_fields & BlockField::reward_scheme_data) {
+        writer.add_column("blocks.data_type", block_data_types);
+        writer.add_column("blocks.shares_per_block", block_shares);
+        writer.add_column("blocks.pool_luck", block_pool_luck);
+        writer.add_column("blocks.receiver_id", block_receiver_ids);
+        writer.add_column("blocks.credit_balance_receiver", block_credit_balances);
+        writer.add_column("blocks.reset_balance_receiver", block_reset_balances);
+        writer.add_column("blocks.proportion_credits_lost", block_prop_credits_lost);
+        writer.add_column("blocks.total_credits_lost", block_total_credits_lost);
+        writer.add_column("blocks.average_credits_lost", block_average_credits_lost);
+    }
+    writer.add_column("hops.time", hop_times);
+    writer.add_column("hops.miner_id", hop_miner_ids);
+    writer.add_column("hops.previous_pool_id", hop_previous_pool_ids);
+    writer.add_column("hops.next_pool_id", hop_next_pool_ids);
+    writer.add_string_column("pools.name", pool_names);
+    writer.add_string_column("pools.reward_scheme", pool_schemes);
+    writer.add_column("pools.difficulty", pool_difficulties);
+    writer.add_column("pool_miners.pool_id", member_pool_ids);
+    writer.add_column("pool_miners.address_id", member_address_ids);
+    writer.add_column("pool_miners.blocks_mined", member_blocks_mined);
+    writer.add_column("pool_miners.blocks_received", member_blocks_received);
+    writer.add_column("pool_miners.uncles_mined", member_uncles_mined);
+    writer.add_column("pool_miners.uncles_received", member_uncles_received);
+    writer.add_column("pool_miners.share_count", member_shares);
+    writer.add_column("miners.address_id", miner_address_ids);
+    writer.add_string_column("miners.behavior", miner_behaviors);
+    writer.add_string_column("miners.handler_metadata", miner_metadata);
+    writer.add_column("miners.hashrate", miner_hashrates);
+    writer.add_column("miners.blocks_found", miner_blocks_found);
+    writer.add_column("miners.total_work", miner_total_work);
+    writer.write(filepath);
+    index.write(get_index_filepath(filepath));
+}
+
+}
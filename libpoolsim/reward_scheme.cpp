@@ -22,27 +22,22 @@ void from_json(const nlohmann::json& j, RewardConfig& r) {
         j.at("pool_fee").get_to(r.pool_fee);
 }
 
-void to_json(nlohmann::json& j, const BlockMetaData& b) {
-    j = nlohmann::json{
-        {"shares_per_block", b.shares_per_block},
-        {"pool_luck", b.pool_luck}
-    };
-}
-
-void to_json(nlohmann::json& j, const QBBlockMetaData& b) {
-    j = nlohmann::json{
-        {"shares_per_block", b.shares_per_block},
-        {"pool_luck", b.pool_luck},
-        {"credit_balance_receiver", b.credit_balance_receiver},
-        {"receiver_address", b.receiver_address},
-        {"reset_balance_receiver", b.reset_balance_receiver},
-        {"proportion_credits_lost", b.prop_credits_lost},
-        {"total_credits_lost", b.total_credits_lost},
-        {"average_credits_lost", b.average_credits_lost}
-    };
+RewardScheme::~RewardScheme() {}
+
+void RewardScheme::add_memory_usage(MemoryUsage& usage) const {}
+
+const BlockMetaData& RewardScheme::get_block_data() {
+    static const BlockMetaData empty_block_data;
+    return empty_block_data;
 }
 
-RewardScheme::~RewardScheme() {}
+BlockDataType RewardScheme::get_block_data_type() const {
+    return BlockDataType::basic;
+}
+
+void RewardScheme::write_miner_metadata(JSONWriter& writer, Address miner_address) {
+    writer.value(get_miner_metadata(miner_address));
+}
 
 void RewardScheme::set_pool_fee(double _fee) {
     assert(_fee >= 0 && _fee <= 1);
@@ -79,7 +74,7 @@ PPSRewardScheme::PPSRewardScheme(const nlohmann::json& _args) {
     set_pool_fee(pps_config.pool_fee);
 }
 
-void PPSRewardScheme::handle_share(const std::string& miner_address, const Share& share) {
+void PPSRewardScheme::handle_share(Address miner_address, const Share& share) {
    shares_per_block++;
    auto record = find_record(miner_address);
    update_record(record, share);
@@ -100,7 +95,7 @@ void PPSRewardScheme::handle_share(const std::string& miner_address, const Share
     record->inc_uncles_mined();
 }
 
-void PPSRewardScheme::handle_uncle(const std::string& miner_address) {
+void PPSRewardScheme::handle_uncle(Address miner_address) {
     // Not relevant for a traditional PPS scheme, as all shares are paid for directly by the pool
 }
 
@@ -125,14 +120,20 @@ PPLNSRewardScheme::PPLNSRewardScheme(const nlohmann::json& _args) {
     set_pool_fee(pplns_config.pool_fee);
 }
 
-void PPLNSRewardScheme::insert_share(std::string miner_address) {
-    last_n_shares.push_back(miner_address);
+void PPLNSRewardScheme::insert_share(Address miner_address) {
+    if (n > 0 && last_n_shares.size() >= n) {
+        // reuse the node of the oldest share rather than allocating a new one
+        last_n_shares.splice(last_n_shares.end(), last_n_shares, last_n_shares.begin());
+        last_n_shares.back() = miner_address;
+    } else {
+        last_n_shares.push_back(miner_address);
+    }
     while (last_n_shares.size() > n) {
         last_n_shares.pop_front();
     }
 }
 
-void PPLNSRewardScheme::handle_share(const std::string& miner_address, const Share& share) {
+void PPLNSRewardScheme::handle_share(Address miner_address, const Share& share) {
     auto miner_record = find_record(miner_address);
     update_record(miner_record, share);
     shares_per_block++;
@@ -145,7 +146,7 @@ void PPLNSRewardScheme::handle_share(const std::string& miner_address, const Sha
     block_meta_data.pool_luck = get_pool_luck();
 
     if (!share.is_uncle()) {
-        for (const std::string& miner_address : last_n_shares) {
+        for (Address miner_address : last_n_shares) {
             auto record = find_record(miner_address);
             record->inc_blocks_received((1.0/last_n_shares.size()));
         }
@@ -169,8 +170,8 @@ void PPLNSRewardScheme::set_n(uint64_t _n) {
     n = _n;
 }
 
-void PPLNSRewardScheme::handle_uncle(const std::string& miner_address) {
-    for (const std::string& miner_address : last_n_shares) {
+void PPLNSRewardScheme::handle_uncle(Address miner_address) {
+    for (Address miner_address : last_n_shares) {
         auto record = find_record(miner_address);
         record->inc_uncles_received(1.0/last_n_shares.size());
     }
@@ -240,7 +241,7 @@ uint_fast64_t QBRewardScheme::get_credits_sum() {
     return sum;
 }
 
-void QBRewardScheme::handle_share(const std::string& miner_address, const Share& share) {
+void QBRewardScheme::handle_share(Address miner_address, const Share& share) {
     shares_per_block++;
     auto record = this->find_record(miner_address);
     this->update_record(record, share);
@@ -258,12 +259,12 @@ void QBRewardScheme::handle_share(const std::string& miner_address, const Share&
     }
 }
 
-uint64_t QBRewardScheme::get_credits(const std::string& miner_address) {
+uint64_t QBRewardScheme::get_credits(Address miner_address) {
     auto record = this->find_record(miner_address);
     return record->get_credits();
 }
 
-void QBRewardScheme::handle_uncle(const std::string& miner_address) {
+void QBRewardScheme::handle_uncle(Address miner_address) {
     auto random_miner = random->random_element(records.begin(), records.end());
     random_miner->inc_uncles_received();
 }
@@ -280,7 +281,7 @@ PROPRewardScheme::PROPRewardScheme(const nlohmann::json& _args) {
     set_pool_fee(prop_config.pool_fee);
 }
 
-void PROPRewardScheme::handle_share(const std::string& miner_address, const Share& share) {
+void PROPRewardScheme::handle_share(Address miner_address, const Share& share) {
     shares_per_block++;
     auto record = find_record(miner_address);
     update_record(record, share);
@@ -303,14 +304,14 @@ void PROPRewardScheme::handle_share(const std::string& miner_address, const Shar
     }
 }
 
-void PROPRewardScheme::handle_uncle(const std::string& miner_address) {
+void PROPRewardScheme::handle_uncle(Address miner_address) {
     for (auto record : records) {
         double reward = (record->get_shares_per_round()/(double)shares_per_block);
         record->inc_uncles_received(reward);
     }
 }
 
-std::list<std::string>& PPLNSRewardScheme::get_last_n_shares() {
+std::list<Address>& PPLNSRewardScheme::get_last_n_shares() {
     return last_n_shares;
 }
 
@@ -318,6 +319,11 @@ uint64_t PPLNSRewardScheme::get_last_n_shares_size() const {
     return last_n_shares.size();
 }
 
+void PPLNSRewardScheme::add_memory_usage(MemoryUsage& usage) const {
+    BaseRewardScheme<PPLNSRewardScheme>::add_memory_usage(usage);
+    usage["pplns_window"] += last_n_shares.size() * (sizeof(Address) + list_node_overhead);
+}
+
 void PROPRewardScheme::update_record(std::shared_ptr<MinerRecord> record, const Share& share) {
     record->inc_shares_count();
     record->inc_shares_per_round();
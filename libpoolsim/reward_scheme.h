@@ -4,11 +4,19 @@
 #include <nlohmann/json.hpp>
 #include <list>
 #include <map>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 
 #include "share.h"
 #include "factory.h"
 #include "random.h"
 #include "miner_record.h"
+#include "address.h"
+#include "block_event.h"
+#include "json_writer.h"
+#include "memory_usage.h"
 
 namespace poolsim {
 
@@ -22,25 +30,11 @@ struct PPLNSConfig : RewardConfig {
     uint64_t n = 0;
 };
 
-struct BlockMetaData {
-    uint64_t shares_per_block = 0;
-    double pool_luck = 0;
-};
-
-struct QBBlockMetaData : BlockMetaData {
-    uint64_t credit_balance_receiver = 0;
-    std::string receiver_address;
-    uint64_t reset_balance_receiver = 0;
-    double prop_credits_lost = 0;
-    double total_credits_lost = 0;
-    double average_credits_lost = 0;
-};
-
 class RewardScheme {
 public:
     virtual ~RewardScheme();
 
-    virtual void handle_share(const std::string& miner_address, const Share& share) = 0;
+    virtual void handle_share(Address miner_address, const Share& share) = 0;
 
     // Set the mining pool for this reward scheme
     // RewardScheme and MiningPool should be a 1 to 1 relationship
@@ -49,12 +43,25 @@ public:
     // returns the metadata of the last block mined as json (including uncle blocks)
     virtual nlohmann::json get_json_metadata() = 0;
 
+    // returns the metadata of the last block mined (including uncle blocks)
+    // its actual type is given by get_block_data_type
+    virtual const BlockMetaData& get_block_data();
+
+    // returns the type of the metadata returned by get_block_data
+    virtual BlockDataType get_block_data_type() const;
+
     // returns the metadata for a miner
-    virtual nlohmann::json get_miner_metadata(const std::string& miner_address) = 0;
+    virtual nlohmann::json get_miner_metadata(Address miner_address) = 0;
+
+    // writes the metadata for a miner, same as get_miner_metadata
+    virtual void write_miner_metadata(JSONWriter& writer, Address miner_address);
 
     // returns the name of the reward scheme
     virtual std::string get_scheme_name() const = 0;
 
+    // adds the estimated bytes held by the scheme, nothing by default
+    virtual void add_memory_usage(MemoryUsage& usage) const;
+
     // Returns the mining_pool of this reward scheme as a shared_ptr
     // Use this rather than accessing the weak_ptr property
     std::shared_ptr<MiningPool> get_mining_pool();
@@ -65,13 +72,13 @@ public:
     double get_pool_luck();
 
     // USED FOR TESTING
-    virtual double get_blocks_received(const std::string& miner_address) = 0;
-    virtual uint64_t get_blocks_mined(const std::string& miner_address) = 0;
-    virtual std::shared_ptr<MinerRecord> get_record(const std::string& miner_address) = 0;
+    virtual double get_blocks_received(Address miner_address) = 0;
+    virtual uint64_t get_blocks_mined(Address miner_address) = 0;
+    virtual std::shared_ptr<MinerRecord> get_record(Address miner_address) = 0;
 
 protected:
     // logic for distributing uncle block reward in pool
-    virtual void handle_uncle(const std::string& miner_address) = 0;
+    virtual void handle_uncle(Address miner_address) = 0;
 
     std::weak_ptr<MiningPool> mining_pool;
     // number of shares submitted per block mined (NOT including uncles)
@@ -84,6 +91,19 @@ protected:
 
 MAKE_FACTORY(RewardSchemeFactory, RewardScheme, const nlohmann::json&);
 
+// Passes a share to a reward scheme known to be a RewardSchemeClass
+// The qualified call lets the compiler skip the vtable, and
+// RewardSchemeClass = RewardScheme keeps the usual virtual dispatch
+template <typename RewardSchemeClass>
+inline void dispatch_share(RewardScheme& reward_scheme, Address miner_address, const Share& share) {
+    static_cast<RewardSchemeClass&>(reward_scheme).RewardSchemeClass::handle_share(miner_address, share);
+}
+
+template <>
+inline void dispatch_share<RewardScheme>(RewardScheme& reward_scheme, Address miner_address, const Share& share) {
+    reward_scheme.handle_share(miner_address, share);
+}
+
 template <typename T, typename RecordClass=MinerRecord, typename BlockData=BlockMetaData>
 class BaseRewardScheme :
     public RewardScheme,
@@ -95,11 +115,16 @@ public:
     // returns the last block metadat
     BlockData get_block_metadata() const;
 
+    // adds the bytes of the records as "records.<scheme name>"
+    virtual void add_memory_usage(MemoryUsage& usage) const override;
+
     using record_class = RecordClass;
     using block_metadata_class = BlockData;
 
 protected:
     std::vector<std::shared_ptr<RecordClass>> records;
+    // records by address ID, records itself being reordered by some schemes
+    std::unordered_map<uint32_t, std::shared_ptr<RecordClass>> records_by_address;
 
     // increments mined block and credits stats for a given record
     virtual void update_record(std::shared_ptr<RecordClass> record, const Share& share) = 0;
@@ -107,11 +132,16 @@ protected:
     // returns the metadata needed when a block has been mined
     virtual nlohmann::json get_json_metadata() override;
 
+    // returns the metadata of the last block mined
+    virtual const BlockMetaData& get_block_data() override;
+    virtual BlockDataType get_block_data_type() const override;
+
     // returns the metadata for a miner
-    virtual nlohmann::json get_miner_metadata(const std::string& miner_address) override;
+    virtual nlohmann::json get_miner_metadata(Address miner_address) override;
+    virtual void write_miner_metadata(JSONWriter& writer, Address miner_address) override;
 
     // returns record of a miner if it exists, otherwise a new record is created and returned
-    std::shared_ptr<RecordClass> find_record(const std::string& miner_address);
+    std::shared_ptr<RecordClass> find_record(Address miner_address);
 
     //stores the meta data associated to the last block mined
     BlockData block_meta_data;
@@ -120,9 +150,9 @@ protected:
     //std::vector<shared_ptr<RecordClass>> get_all_records();
     
     // USED FOR TESTING
-    virtual double get_blocks_received(const std::string& miner_address) override;
-    virtual uint64_t get_blocks_mined(const std::string& miner_address) override;
-    virtual std::shared_ptr<MinerRecord> get_record(const std::string& miner_address) override;
+    virtual double get_blocks_received(Address miner_address) override;
+    virtual uint64_t get_blocks_mined(Address miner_address) override;
+    virtual std::shared_ptr<MinerRecord> get_record(Address miner_address) override;
 };
 
 template <typename T, typename RecordClass, typename BlockData>
@@ -135,17 +165,28 @@ BlockData BaseRewardScheme<T, RecordClass, BlockData>::get_block_metadata() cons
     return block_meta_data;
 }
 
+template <typename T, typename RecordClass, typename BlockData>
+void BaseRewardScheme<T, RecordClass, BlockData>::add_memory_usage(MemoryUsage& usage) const {
+    usage["records." + get_scheme_name()] += poolsim::get_memory_usage(records) +
+        poolsim::get_memory_usage(records_by_address) +
+        records.size() * (sizeof(RecordClass) + shared_control_block_size);
+}
+
 
 template <typename T, typename RecordClass, typename BlockData>
-std::shared_ptr<RecordClass> BaseRewardScheme<T, RecordClass, BlockData>::find_record(const std::string& miner_address) {
-  for (auto iter = records.begin(); iter != records.end(); ++iter) {
-    if ((*iter)->get_miner_address() == miner_address)
-      return (*iter);
-  }
-
-  auto record = std::make_shared<RecordClass>(miner_address);
-  records.push_back(record);
-  return record;
+std::shared_ptr<RecordClass> BaseRewardScheme<T, RecordClass, BlockData>::find_record(Address miner_address) {
+    if (miner_address.is_null()) {
+        throw std::invalid_argument("cannot find the record of a null address");
+    }
+    auto it = records_by_address.find(miner_address.get_id());
+    if (it != records_by_address.end()) {
+        return it->second;
+    }
+
+    auto record = std::make_shared<RecordClass>(miner_address);
+    records.push_back(record);
+    records_by_address.emplace(miner_address.get_id(), record);
+    return record;
 }
 
 template<typename T, typename RecordClass, typename BlockData>
@@ -156,29 +197,44 @@ nlohmann::json BaseRewardScheme<T, RecordClass, BlockData>::get_json_metadata()
 }
 
 template<typename T, typename RecordClass, typename BlockData>
-nlohmann::json BaseRewardScheme<T, RecordClass, BlockData>::get_miner_metadata(const std::string& miner_address) {
+nlohmann::json BaseRewardScheme<T, RecordClass, BlockData>::get_miner_metadata(Address miner_address) {
     nlohmann::json j;
     to_json(j, *find_record(miner_address));
     return j;
 }
 
+template<typename T, typename RecordClass, typename BlockData>
+void BaseRewardScheme<T, RecordClass, BlockData>::write_miner_metadata(JSONWriter& writer, Address miner_address) {
+    write_json(writer, *find_record(miner_address));
+}
+
+template<typename T, typename RecordClass, typename BlockData>
+const BlockMetaData& BaseRewardScheme<T, RecordClass, BlockData>::get_block_data() {
+    return block_meta_data;
+}
+
+template<typename T, typename RecordClass, typename BlockData>
+BlockDataType BaseRewardScheme<T, RecordClass, BlockData>::get_block_data_type() const {
+    return block_data_type<BlockData>::value;
+}
+
 // USED FOR TESTING
 template<typename T, typename RecordClass, typename BlockData>
-double BaseRewardScheme<T, RecordClass, BlockData>::get_blocks_received(const std::string& miner_address) {
+double BaseRewardScheme<T, RecordClass, BlockData>::get_blocks_received(Address miner_address) {
     auto record = find_record(miner_address);
     return record->get_blocks_received();
 }
 
 // USED FOR TESTING
 template<typename T, typename RecordClass, typename BlockData>
-uint64_t BaseRewardScheme<T, RecordClass, BlockData>::get_blocks_mined(const std::string& miner_address) {
+uint64_t BaseRewardScheme<T, RecordClass, BlockData>::get_blocks_mined(Address miner_address) {
     auto record = find_record(miner_address);
     return record->get_blocks_mined();
 }
 
 // USED FOR TESTING
 template<typename T, typename RecordClass, typename BlockData>
-std::shared_ptr<MinerRecord> BaseRewardScheme<T, RecordClass, BlockData>::get_record(const std::string& miner_address) {
+std::shared_ptr<MinerRecord> BaseRewardScheme<T, RecordClass, BlockData>::get_record(Address miner_address) {
     auto record = find_record(miner_address);
     return record;
 }
@@ -190,11 +246,11 @@ public:
 
     std::string get_scheme_name() const override;
 
-    void handle_share(const std::string& miner_address, const Share& share) override;
+    void handle_share(Address miner_address, const Share& share) override;
 private:
-    void handle_uncle(const std::string& miner_address) override;
+    void handle_uncle(Address miner_address) override;
 
-    void update_record(std::shared_ptr<MinerRecord> record, const Share& share) override;
+    void update_record(std::shared_ptr<MinerRecord> record, const Share& share) override final;
 };
 
 // Pay-per-last-n-shares reward scheme
@@ -204,25 +260,28 @@ public:
 
     std::string get_scheme_name() const override;
 
-    void handle_share(const std::string& miner_address, const Share& share) override;
+    void handle_share(Address miner_address, const Share& share) override;
 
     void set_n(uint64_t _n);
 
     // USED FOR TESTS
-    std::list<std::string>& get_last_n_shares();
+    std::list<Address>& get_last_n_shares();
     uint64_t get_last_n_shares_size() const;
 
+    // adds the bytes of the last n shares as "pplns_window"
+    void add_memory_usage(MemoryUsage& usage) const override;
+
 private:
-    void handle_uncle(const std::string& miner_address) override;
+    void handle_uncle(Address miner_address) override;
     
-    void update_record(std::shared_ptr<MinerRecord> record, const Share& share) override;
+    void update_record(std::shared_ptr<MinerRecord> record, const Share& share) override final;
 
     // the number of last shares over which a reward will be distributed
     uint64_t n = 0;
     // list of miner addresses that submitted last n shares
-    std::list<std::string> last_n_shares;
+    std::list<Address> last_n_shares;
     // inserts a miners address to the list of address of last n miners that submitted a share
-    void insert_share(std::string miner_address);
+    void insert_share(Address miner_address);
 };
 
 // Queue-based reward scheme
@@ -232,17 +291,17 @@ public:
 
     std::string get_scheme_name() const override;
 
-    void handle_share(const std::string& miner_address, const Share& share) override;
+    void handle_share(Address miner_address, const Share& share) override;
     
-    uint64_t get_credits(const std::string& miner_address);
+    uint64_t get_credits(Address miner_address);
 
 protected:
     // by default: sample a random miner from the pool for receiving the full uncle reward
-    void handle_uncle(const std::string& miner_address) override;
+    void handle_uncle(Address miner_address) override;
     // updates stats of top miner in pool and resets the top miners credits
     void reward_top_miner();
     // updates the given record based on the type of share accordingly 
-    void update_record(std::shared_ptr<QBRecord> record, const Share& share) override;
+    void update_record(std::shared_ptr<QBRecord> record, const Share& share) override final;
     // returns the total sum of credit balances by pool
     uint64_t get_credits_sum();
 };
@@ -254,17 +313,15 @@ public:
 
     std::string get_scheme_name() const override;
 
-    void handle_share(const std::string& miner_address, const Share& share) override;
+    void handle_share(Address miner_address, const Share& share) override;
 
 private:
-    void handle_uncle(const std::string& miner_address) override;   
+    void handle_uncle(Address miner_address) override;   
     
-    void update_record(std::shared_ptr<MinerRecord> record, const Share& share) override;
+    void update_record(std::shared_ptr<MinerRecord> record, const Share& share) override final;
 };
 
 void from_json(const nlohmann::json& j, PPLNSConfig& r);
 void from_json(const nlohmann::json& j, RewardConfig& r);
-void to_json(nlohmann::json& j, const BlockMetaData& b);
-void to_json(nlohmann::json& j, const QBBlockMetaData& b);
 
 }
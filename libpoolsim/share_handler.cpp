@@ -7,6 +7,8 @@
 #include <spdlog/spdlog.h>
 
 #include <iterator>
+#include <map>
+#include <mutex>
 #include <algorithm>
 
 namespace poolsim {
@@ -45,6 +47,43 @@ void to_json(nlohmann::json& j, const HopEvent& event) {
 
 ShareHandler::~ShareHandler() {}
 
+void ShareHandler::handle_share(Miner& _miner, const Share& share) {
+    handle_share(share);
+}
+
+bool ShareHandler::is_flyweight() const {
+    return false;
+}
+
+void ShareHandler::add_memory_usage(MemoryUsage& usage) const {}
+
+nlohmann::json ShareHandler::get_encoded_json_metadata(OutputDictionary& dictionary) {
+    return get_json_metadata();
+}
+
+std::shared_ptr<ShareHandler> create_share_handler(const std::string& name, const nlohmann::json& args) {
+    // the miners own the flyweights, expired ones are dropped when another one is added
+    static std::mutex flyweights_mutex;
+    static std::map<std::string, std::weak_ptr<ShareHandler>> flyweights;
+    std::string key = name + args.dump();
+
+    std::lock_guard<std::mutex> lock(flyweights_mutex);
+    auto it = flyweights.find(key);
+    if (it != flyweights.end()) {
+        if (auto handler = it->second.lock()) {
+            return handler;
+        }
+    }
+    std::shared_ptr<ShareHandler> handler = ShareHandlerFactory::create(name, args);
+    if (handler->is_flyweight()) {
+        for (auto expired = flyweights.begin(); expired != flyweights.end();) {
+            expired = expired->second.expired() ? flyweights.erase(expired) : std::next(expired);
+        }
+        flyweights[key] = handler;
+    }
+    return handler;
+}
+
 void ShareHandler::set_miner(std::shared_ptr<Miner> _miner) {
   miner = _miner;
 }
@@ -53,24 +92,32 @@ const std::shared_ptr<Miner> ShareHandler::get_miner() const {
   return miner.lock();
 }
 
+const std::shared_ptr<Miner> ShareHandler::get_bound_miner() const {
+    auto bound_miner = get_miner();
+    if (bound_miner == nullptr) {
+        throw std::logic_error(get_name() + " handler is not bound to a miner");
+    }
+    return bound_miner;
+}
+
 const std::shared_ptr<Network> ShareHandler::get_network() const {
-    return get_miner()->get_network();
+    return get_bound_miner()->get_network();
 }
 
 std::shared_ptr<MiningPool> ShareHandler::get_pool() const {
-    return get_miner()->get_pool();
+    return get_bound_miner()->get_pool();
 }
 
-std::string ShareHandler::get_address() const {
-    return get_miner()->get_address();
+Address ShareHandler::get_address() const {
+    return get_bound_miner()->get_address();
 }
 
 // NOTE: this particular class probably does not need for args
 // but it must accept them because of the current factory implementation
 DefaultShareHandler::DefaultShareHandler(const nlohmann::json& _args) {}
 
-void DefaultShareHandler::handle_share(const Share& share) {
-    get_pool()->submit_share(get_address(), share);
+void DefaultShareHandler::handle_share(Miner& miner, const Share& share) {
+    handle_share_with<RewardScheme>(*miner.get_pool(), miner.get_address(), share);
 }
 
 std::string DefaultShareHandler::get_name() const {
@@ -81,10 +128,8 @@ REGISTER(ShareHandler, DefaultShareHandler, "default")
 
 WithholdingShareHandler::WithholdingShareHandler(const nlohmann::json& _args) {}
 
-void WithholdingShareHandler::handle_share(const Share& share) {
-    if (!share.is_valid_block())
-        get_pool()->submit_share(get_address(), share);
-    
+void WithholdingShareHandler::handle_share(Miner& miner, const Share& share) {
+    handle_share_with<RewardScheme>(*miner.get_pool(), miner.get_address(), share);
 }
 
 std::string WithholdingShareHandler::get_name() const {
@@ -110,14 +155,14 @@ uint64_t QBShareHandler::get_valid_shares_donated() const {
 }
 
 bool QBShareHandler::should_attack(std::vector<std::shared_ptr<QBRecord>>& records) {
-    return get_victim_address(records) != "";
+    return !get_victim_address(records).is_null();
 }
 
 bool QBShareHandler::is_pool_queue_based() const {
     return get_pool()->get_scheme_name() == "QB";
 }
 
-std::string QBShareHandler::get_victim_address(std::vector<std::shared_ptr<QBRecord>>& records) {
+Address QBShareHandler::get_victim_address(std::vector<std::shared_ptr<QBRecord>>& records) {
     for (size_t i = 0; i + 1 < records.size() && i < top_n; i++) {
         auto record = records[i];
         if (record->get_miner_address() == get_address()) {
@@ -127,7 +172,7 @@ std::string QBShareHandler::get_victim_address(std::vector<std::shared_ptr<QBRec
             } 
         }
     }
-    return "";
+    return Address();
 }
 
 QBWithholdingShareHandler::QBWithholdingShareHandler(const nlohmann::json& _args) {
@@ -171,25 +216,27 @@ DonationShareHandler::DonationShareHandler(const nlohmann::json& _args) {
 }
 
 void DonationShareHandler::handle_share(const Share& share) {
+    handle_share_with<RewardScheme>(*get_pool(), get_address(), share);
+}
+
+Address DonationShareHandler::get_receiver_address(Address address, const Share& share) {
     if (!is_pool_queue_based()) {
-        get_pool()->submit_share(get_address(), share);
-        return;   
+        return address;
     }
     
     auto records = get_pool()->get_records<QBRewardScheme>();
     std::sort(records.begin(), records.end(), QBSortObj());
     
-    std::string victim_address = get_victim_address(records);
-    if (victim_address == "") {
-        get_pool()->submit_share(get_address(), share);
-        return;
+    Address victim_address = get_victim_address(records);
+    if (victim_address.is_null()) {
+        return address;
     }
 
     shares_donated++;
     if (share.is_valid_block())
         valid_shares_donated++;
 
-    get_pool()->submit_share(victim_address, share);
+    return victim_address;
 }
 
 std::string DonationShareHandler::get_name() const {
@@ -209,7 +256,7 @@ MultipleAddressesShareHandler::MultipleAddressesShareHandler(const nlohmann::jso
     }
 
     for (size_t count = 0; count < addresses_count; count++) {
-        std::string new_address = random->get_address();
+        Address new_address = random->get_address();
         addresses.push_back(new_address);
     }
 }
@@ -218,7 +265,7 @@ uint64_t MultipleAddressesShareHandler::get_addresses_count() const {
     return addresses.size();
 }
 
-std::string MultipleAddressesShareHandler::get_random_address() const {
+Address MultipleAddressesShareHandler::get_random_address() const {
     return random->random_element(addresses.begin(), addresses.end());
 }
 
@@ -241,7 +288,7 @@ void MultipleAddressesShareHandler::handle_share(const Share& share) {
         valid_shares_donated++;
 
 
-    std::string other_address = get_random_address();
+    Address other_address = get_random_address();
     // NOTE: join will be a no-op if the other address is already in the pool
     get_pool()->join(other_address);
     get_pool()->submit_share(other_address, share);
@@ -259,6 +306,28 @@ nlohmann::json QBPoolHopping::get_json_metadata() {
     return j;
 }
 
+nlohmann::json QBPoolHopping::get_encoded_json_metadata(OutputDictionary& dictionary) {
+    nlohmann::json events = nlohmann::json::array();
+    for (const HopEvent& event : hop_events) {
+        events.push_back({
+            {"next_pool_id", dictionary.pool_names.get_id(event.next_pool)},
+            {"previous_pool_id", dictionary.pool_names.get_id(event.previous_pool)},
+            {"time", event.time}
+        });
+    }
+    nlohmann::json j;
+    j["hop_events"] = events;
+    return j;
+}
+
+void QBPoolHopping::add_memory_usage(MemoryUsage& usage) const {
+    uint64_t bytes = poolsim::get_memory_usage(hop_events);
+    for (const HopEvent& event : hop_events) {
+        bytes += poolsim::get_memory_usage(event.previous_pool) + poolsim::get_memory_usage(event.next_pool);
+    }
+    usage["hop_events"] += bytes;
+}
+
 void QBPoolHopping::handle_share(const Share& share) {
     if (!is_pool_queue_based()) {
         get_pool()->submit_share(get_address(), share);
@@ -283,12 +352,16 @@ void QBPoolHopping::handle_share(const Share& share) {
         auto pool_to_hop = get_hop_target();
         if (pool_to_hop != current_pool) {
             get_miner()->join_pool(pool_to_hop);
-            HopEvent event {
-                .previous_pool = current_pool->get_name(),
-                .next_pool = pool_to_hop->get_name(),
-                .time = get_network()->get_current_time()
-            };
-            hop_events.push_back(event);
+            if (get_network()->records_hop_events()) {
+                HopEvent event {
+                    .previous_pool = current_pool->get_name(),
+                    .next_pool = pool_to_hop->get_name(),
+                    .time = get_network()->get_current_time(),
+                    .miner_address = get_address()
+                };
+                hop_events.push_back(event);
+                get_network()->notify(event);
+            }
        }
     }
 
@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 
 #include "simulation.h"
 
@@ -40,6 +41,50 @@ void from_json(const json& j, Simulation& simulation) {
     if (j.find("seed") != j.end()) {
         j.at("seed").get_to(simulation.seed);
     }
+    if (j.find("compact_output") != j.end()) {
+        j.at("compact_output").get_to(simulation.compact_output);
+    }
+    if (j.find("async_output") != j.end()) {
+        j.at("async_output").get_to(simulation.async_output);
+    }
+    if (j.find("snapshot_interval") != j.end()) {
+        j.at("snapshot_interval").get_to(simulation.snapshot_interval);
+    }
+    if (j.find("output_options") != j.end()) {
+        j.at("output_options").get_to(simulation.output_config);
+    }
+}
+
+void from_json(const json& j, OutputConfig& output_config) {
+    if (j.find("detail") != j.end()) {
+        std::string detail = j.at("detail").get<std::string>();
+        if (detail != "summary" && detail != "blocks") {
+            throw std::invalid_argument("output detail must be summary or blocks, not " + detail);
+        }
+        output_config.blocks = detail == "blocks";
+    }
+    if (j.find("block_fields") != j.end()) {
+        output_config.block_fields = BlockField::none;
+        for (const std::string& name : j.at("block_fields").get<std::vector<std::string>>()) {
+            output_config.block_fields |= BlockField::from_name(name);
+        }
+    }
+    if (j.find("block_interval") != j.end()) {
+        j.at("block_interval").get_to(output_config.block_interval);
+        if (output_config.block_interval == 0) {
+            throw std::invalid_argument("output block_interval must be greater than 0");
+        }
+    }
+    if (j.find("hop_events") != j.end()) {
+        j.at("hop_events").get_to(output_config.hop_events);
+    }
+    if (j.find("encoding") != j.end()) {
+        std::string encoding = j.at("encoding").get<std::string>();
+        if (encoding != "strings" && encoding != "dictionary") {
+            throw std::invalid_argument("output encoding must be strings or dictionary, not " + encoding);
+        }
+        output_config.dictionary_encoding = encoding == "dictionary";
+    }
 }
 
 
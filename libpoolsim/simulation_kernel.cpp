@@ -0,0 +1,78 @@
+#include "simulator.h"
+#include "reward_scheme.h"
+#include "share_handler.h"
+#include "profiler.h"
+#include "tracer.h"
+
+namespace poolsim {
+
+// The share path of the loop below is resolved at compile time:
+// the handler and the reward scheme are called without going through
+// their vtables, which lets the compiler inline most of it
+template <typename RewardSchemeClass, typename ShareHandlerClass>
+void Simulator::run_specialized_events() {
+    TraceSampler sampler;
+    while (network->get_current_block() < simulation.blocks) {
+        auto event = queue.pop();
+        Share share = draw_share(event);
+        Miner& miner = *miners[event.miner_id];
+        miner.record_share(share);
+        auto share_handler = static_cast<ShareHandlerClass*>(miner_table[event.miner_id].share_handler);
+        POOLSIM_PROFILE_SCOPE(share_handler);
+        share_handler->template handle_share_with<RewardSchemeClass>(
+            *miner.get_pool(), miner.get_address(), share);
+        sampler.tick();
+    }
+}
+
+template <typename RewardSchemeClass>
+Simulator::Kernel Simulator::select_kernel(const std::type_info& handler_type) {
+    if (handler_type == typeid(DefaultShareHandler)) {
+        return &Simulator::run_specialized_events<RewardSchemeClass, DefaultShareHandler>;
+    } else if (handler_type == typeid(WithholdingShareHandler)) {
+        return &Simulator::run_specialized_events<RewardSchemeClass, WithholdingShareHandler>;
+    } else if (handler_type == typeid(DonationShareHandler)) {
+        return &Simulator::run_specialized_events<RewardSchemeClass, DonationShareHandler>;
+    }
+    return &Simulator::run_events;
+}
+
+Simulator::Kernel Simulator::select_kernel() const {
+    if (pools.empty() || miners.empty()) {
+        return &Simulator::run_events;
+    }
+
+    const std::type_info& scheme_type = typeid(pools[0]->get_reward_scheme());
+    for (auto pool : pools) {
+        if (typeid(pool->get_reward_scheme()) != scheme_type) {
+            return &Simulator::run_events;
+        }
+    }
+
+    // pool hopping handlers are not specialized, so miners always stay in their pool
+    const ShareHandler* first_handler = miner_table[0].share_handler;
+    if (first_handler == nullptr) {
+        return &Simulator::run_events;
+    }
+    const std::type_info& handler_type = typeid(*first_handler);
+    for (uint32_t miner_id = 0; miner_id < miners.size(); miner_id++) {
+        const ShareHandler* share_handler = miner_table[miner_id].share_handler;
+        if (typeid(*miners[miner_id]) != typeid(Miner) || share_handler == nullptr
+                || typeid(*share_handler) != handler_type) {
+            return &Simulator::run_events;
+        }
+    }
+
+    if (scheme_type == typeid(PPSRewardScheme)) {
+        return select_kernel<PPSRewardScheme>(handler_type);
+    } else if (scheme_type == typeid(PPLNSRewardScheme)) {
+        return select_kernel<PPLNSRewardScheme>(handler_type);
+    } else if (scheme_type == typeid(QBRewardScheme)) {
+        return select_kernel<QBRewardScheme>(handler_type);
+    } else if (scheme_type == typeid(PROPRewardScheme)) {
+        return select_kernel<PROPRewardScheme>(handler_type);
+    }
+    return &Simulator::run_events;
+}
+
+}
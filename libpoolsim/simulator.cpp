@@ -1,17 +1,9 @@
-#include <fstream>
-#include <iostream>
 #include <sstream>
-#include <iomanip>
+#include <iostream>
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 
-
-#ifdef USE_BOOST_IOSTREAMS
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-#endif
-
 #include <spdlog/spdlog.h>
 
 #include "simulator.h"
@@ -20,18 +12,27 @@
 #include "miner.h"
 #include "event.h"
 #include "miner_creator.h"
+#include "async_result_writer.h"
+#include "profiler.h"
+#include "allocation_tracker.h"
+#include "perf_counters.h"
+#include "tracer.h"
 
 namespace poolsim {
 
 using nlohmann::json;
 
+// events between two checks of whether a progress report is due, a power of 2
+static const uint64_t progress_check_events = 4096;
+
 
 Simulator::Simulator(Simulation _simulation)
     : Simulator(_simulation, SystemRandom::get_instance()) {}
 
 Simulator::Simulator(Simulation _simulation, std::shared_ptr<Random> _random)
     : simulation(_simulation), network(std::make_shared<Network>(_simulation.network_difficulty)),
-      random(_random) {}
+      random(_random),
+      kernel(&Simulator::run_events) {}
 
 std::shared_ptr<Simulator> Simulator::from_config_file(const std::string& filepath, const int seed) {
     auto simulation = Simulation::from_config_file(filepath);
@@ -61,15 +62,23 @@ void Simulator::initialize() {
         // Create all the miners in the configuration
         std::vector<std::shared_ptr<Miner>> pool_miners;
         for (const MinerConfig& miner_config : pool_config.miners_config) {
+            TraceSpan span("initialize", "create_miners",
+                           {{"pool", pool_name}, {"generator", miner_config.generator}});
             auto miner_creator = MinerCreatorFactory::create(miner_config.generator, network);
             auto new_miners = miner_creator->create_miners(miner_config.params);
+            span.set_arg("miners", new_miners.size());
             pool_miners.insert(pool_miners.end(), new_miners.begin(), new_miners.end());
         }
 
         // Create pool reward scheme
         auto reward_scheme_config = pool_config.reward_scheme_config;
-        auto reward_scheme = RewardSchemeFactory::create(reward_scheme_config.scheme_type,
-                                                         reward_scheme_config.params);
+        std::unique_ptr<RewardScheme> reward_scheme;
+        {
+            TraceSpan span("initialize", "create_reward_scheme",
+                           {{"pool", pool_name}, {"scheme", reward_scheme_config.scheme_type}});
+            reward_scheme = RewardSchemeFactory::create(reward_scheme_config.scheme_type,
+                                                        reward_scheme_config.params);
+        }
 
         // Create and initialize pool
         auto pool = MiningPool::create(pool_name,
@@ -78,19 +87,43 @@ void Simulator::initialize() {
                                        std::move(reward_scheme),
                                        network);
         network->register_pool(pool);
-        pool->add_observer(shared_from_this());
+        // pools only build block events when they are observed
+        if (simulation.output_config.blocks) {
+            pool->add_observer(std::static_pointer_cast<Observer<BlockEvent>>(shared_from_this()));
+        }
         add_pool(pool);
 
         // Add all miners to pool and simulator
+        miners.reserve(miners.size() + pool_miners.size());
+        miner_table.reserve(miners.size() + pool_miners.size());
         for (auto miner : pool_miners) {
             miner->join_pool(pool);
             add_miner(miner);
         }
     }
+
+    network->set_record_hop_events(simulation.output_config.hop_events);
+    if (simulation.output_config.hop_events) {
+        network->add_observer(std::static_pointer_cast<Observer<HopEvent>>(shared_from_this()));
+    }
+    kernel = specialization_enabled ? select_kernel() : &Simulator::run_events;
+    spdlog::debug("using {} event loop", is_specialized() ? "specialized" : "generic");
+}
+
+bool Simulator::is_specialized() const {
+    return kernel != &Simulator::run_events;
+}
+
+void Simulator::disable_specialization() {
+    specialization_enabled = false;
 }
 
 void Simulator::run() {
-    initialize();
+    AllocationTracker::get_instance().set_stage(SimulationStage::initialize);
+    {
+        TraceSpan span("initialize", "initialize");
+        initialize();
+    }
 
     spdlog::debug("loaded {} pools with a total of {} miners", pools.size(), miners.size());
 
@@ -98,79 +131,201 @@ void Simulator::run() {
         throw InvalidSimulationException("simulation must have at least one miner and one pool");
     }
 
-    schedule_all();
+    {
+        TraceSpan span("initialize", "schedule_all");
+        schedule_all();
+    }
+    {
+        TraceSpan span("initialize", "create_result_writer");
+        get_result_writer();
+    }
 
     spdlog::info("running {} blocks", simulation.blocks);
 
+    std::unique_ptr<PerfCounters> perf_counters;
+    if (perf_counters_enabled) {
+        perf_counters.reset(new PerfCounters());
+        if (!perf_counters->is_available()) {
+            spdlog::warn("hardware events cannot be counted, check kernel.perf_event_paranoid");
+        }
+        perf_counters->start();
+    }
+
+    if (!progress_destination.empty()) {
+        progress_reporter.reset(new ProgressReporter(progress_destination, progress_interval));
+    }
+    if (!memory_report_destination.empty() && memory_checkpoints > 0) {
+        memory_report_interval = std::max<uint64_t>(1, simulation.blocks / memory_checkpoints);
+    }
+
     auto start = std::chrono::high_resolution_clock::now();
 
-    while (network->get_current_block() < simulation.blocks) {
-        auto event = queue.pop();
-        process_event(event);
+    AllocationTracker::get_instance().set_stage(SimulationStage::run);
+    Profiler::get_instance().reset();
+    {
+        POOLSIM_PROFILE_SCOPE(run);
+        TraceSpan span("run", "run", {{"blocks", simulation.blocks}});
+        (this->*kernel)();
     }
     auto end = std::chrono::high_resolution_clock::now();
 
+    if (perf_counters) {
+        perf_counters->stop();
+        perf_counts = perf_counters->read();
+    }
+    if (progress_reporter) {
+        report_progress(true);
+        progress_reporter.reset();
+    }
+
     duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 }
 
-void Simulator::output_result(const json& result) const {
-    auto filepath = simulation.output;
-    // FIXME: throw if the filepath does not exist or create it
+void Simulator::run_events() {
+    TraceSampler sampler;
+    while (network->get_current_block() < simulation.blocks) {
+        auto event = queue.pop();
+        process_event(event);
+        sampler.tick();
+    }
+}
 
-    if (filepath.substr(filepath.size() - 3, 3) != ".gz") {
-        std::ofstream o(filepath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
-        o << std::setw(4) << result << std::endl;
-        return;
+ResultWriter& Simulator::get_result_writer() {
+    if (result_writer == nullptr) {
+        const OutputConfig& output_config = simulation.output_config;
+        result_writer = ResultWriter::create(simulation.output, simulation.compact_output,
+                                             output_config.blocks ? output_config.block_fields : BlockField::none,
+                                             output_config.dictionary_encoding);
+        if (simulation.async_output) {
+            result_writer.reset(new AsyncResultWriter(std::move(result_writer)));
+        }
     }
+    return *result_writer;
+}
 
-    #ifdef USE_BOOST_IOSTREAMS
-    std::ofstream file(filepath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
-    boost::iostreams::filtering_streambuf<boost::iostreams::output> out;
-    out.push(boost::iostreams::gzip_compressor());
-    out.push(file);
+void Simulator::enable_perf_counters() {
+    perf_counters_enabled = true;
+}
 
-    std::ostream o(&out);
-    o << std::setw(4) << result << std::endl;
-    #else
-    throw std::invalid_argument("boost not found, cannot output gz");
-    #endif
+void Simulator::enable_progress_reports(const std::string& destination, double interval_seconds) {
+    progress_destination = destination;
+    progress_interval = interval_seconds;
 }
 
-void Simulator::save_simulation_data() {
-    json result;
+void Simulator::enable_memory_reports(const std::string& destination, uint64_t checkpoints) {
+    memory_report_destination = destination;
+    memory_checkpoints = checkpoints;
+}
 
-    result["runtime_milliseconds"] = duration;
+MemoryUsage Simulator::get_memory_usage() const {
+    MemoryUsage usage;
+    usage["event_queue"] = queue.get_memory_usage();
+    usage["miners"] = poolsim::get_memory_usage(miners) + miners.size() * (sizeof(Miner) + shared_control_block_size) +
+                      miner_table.get_memory_usage();
+    usage["pool_members"] = 0;
+    for (auto pool : pools) {
+        usage["pool_members"] += pool->get_miners().get_memory_usage();
+        pool->get_reward_scheme().add_memory_usage(usage);
+    }
+    for (uint32_t miner_id = 0; miner_id < miner_table.size(); miner_id++) {
+        const ShareHandler* share_handler = miner_table[miner_id].share_handler;
+        // flyweight handlers are shared by all their miners and hold nothing
+        if (share_handler != nullptr && !share_handler->is_flyweight()) {
+            share_handler->add_memory_usage(usage);
+        }
+    }
+    usage["addresses"] = AddressTable::get_instance().get_memory_usage();
+    if (result_writer) {
+        result_writer->add_memory_usage(usage);
+    }
+    return usage;
+}
 
-    result["blocks"] = json::array();
-    for (auto block : block_events) {
-        result["blocks"].push_back(block);
+void Simulator::report_memory(bool done) {
+    MemoryUsage usage = get_memory_usage();
+    uint64_t estimated_bytes = 0;
+    for (const auto& structure : usage) {
+        estimated_bytes += structure.second;
     }
+    uint64_t rss = get_current_rss_bytes();
+    json report = {
+        {"type", "memory"},
+        {"done", done},
+        {"blocks", network->get_current_block()},
+        {"rss_bytes", rss},
+        {"peak_rss_bytes", std::max(rss, get_peak_rss_bytes())},
+        {"estimated_bytes", estimated_bytes},
+        {"structures", usage}
+    };
+    if (memory_report_destination == "-") {
+        std::cerr << report.dump() << std::endl;
+        return;
+    }
+    if (!memory_report_file) {
+        memory_report_file.reset(new std::ofstream(memory_report_destination));
+    }
+    *memory_report_file << report.dump() << std::endl;
+    if (!*memory_report_file) {
+        throw std::invalid_argument("cannot write " + memory_report_destination);
+    }
+}
 
-    result["pools"] = json::array();
+void Simulator::report_progress(bool done) {
+    if (!done && !progress_reporter->is_due()) {
+        return;
+    }
+    uint64_t shares = 0;
     for (auto pool : pools) {
-        result["pools"].push_back(*pool);
+        shares += pool->get_shares_submitted();
     }
+    progress_reporter->report(ProgressStatus {
+        .blocks = network->get_current_block(),
+        .target_blocks = simulation.blocks,
+        .events = events_count,
+        .shares = shares,
+        .queue_size = queue.size(),
+        .done = done
+    });
+}
 
-    result["miners"] = json::array();
-    for (auto miner_kv : miners) {
-        result["miners"].push_back(*miner_kv.second);
+void Simulator::save_simulation_data() {
+    AllocationTracker::get_instance().set_stage(SimulationStage::save);
+#ifdef POOLSIM_PROFILE
+    get_result_writer().write_profile(Profiler::get_instance());
+#endif
+    if (perf_counters_enabled) {
+        get_result_writer().write_perf_counters(perf_counts);
+        get_result_writer().write_peak_rss(get_peak_rss_bytes());
+    }
+    {
+        TraceSpan span("output", "save");
+        get_result_writer().finish(duration, pools, miners);
+    }
+    if (!memory_report_destination.empty()) {
+        report_memory(true);
     }
-
-    output_result(result);
 }
 
 void Simulator::schedule_all() {
-  for (auto miner_kv: miners) {
-    schedule_miner(miner_kv.second);
+  for (auto miner : miners) {
+    schedule_miner(miner);
   }
 }
 
 void Simulator::process_event(const Event& event) {
+    Share share = draw_share(event);
+    POOLSIM_PROFILE_SCOPE(share_handler);
+    miners[event.miner_id]->process_share(share);
+}
+
+Share Simulator::draw_share(const Event& event) {
+    // the clock is only read once every progress_check_events events
+    if ((++events_count & (progress_check_events - 1)) == 0 && progress_reporter) {
+        report_progress(false);
+    }
     network->set_current_time(event.time);
-    auto miner = get_miner(event.miner_address);
-    auto pool = miner->get_pool();
-    double p = (double) pool->get_difficulty() / simulation.network_difficulty;
-    bool is_network_share = random->drand48() < p;
+    const MinerState& miner_state = miner_table[event.miner_id];
+    bool is_network_share = random->random_uint64() < miner_state.scheduling.block_threshold;
     uint8_t share_flags = Share::Property::none;
     if (is_network_share) {
         network->inc_current_block();
@@ -180,32 +335,40 @@ void Simulator::process_event(const Event& event) {
         } else if (current_block % 100 == 0) {
             spdlog::debug("progress: {} / {}", current_block, simulation.blocks);
         }
+        if (simulation.snapshot_interval > 0 && current_block % simulation.snapshot_interval == 0) {
+            write_snapshots();
+        }
+        if (memory_report_interval > 0 && current_block % memory_report_interval == 0
+                && current_block < simulation.blocks) {
+            report_memory(false);
+        }
         share_flags |= Share::Property::valid_block;
     }
-    Share share(share_flags);
-    schedule_miner(miner);
-    miner->process_share(share);
+    schedule_miner(event.miner_id, miner_state.scheduling);
+    return Share(share_flags);
 }
 
 void Simulator::schedule_miner(const std::shared_ptr<Miner> miner) {
-  auto pool = miner->get_pool();
-  double lambda = miner->get_hashrate() / pool->get_difficulty();
-  double t = -log(random->drand48()) / lambda;
+  schedule_miner(miner->get_id(), miner->get_scheduling());
+}
 
-  Event miner_next_event(miner->get_address(), network->get_current_time() + t);
-  queue.schedule(miner_next_event);
+void Simulator::schedule_miner(uint32_t miner_id, const SchedulingEntry& scheduling) {
+  POOLSIM_PROFILE_SCOPE(scheduling);
+  double t = -log(random->drand48()) * scheduling.share_interval;
+  queue.schedule(Event(miner_id, network->get_current_time() + t));
 }
 
 void Simulator::add_miner(std::shared_ptr<Miner> miner) {
-  miners[miner->get_address()] = miner;
+  miner->move_to_table(miner_table);
+  miners.push_back(miner);
 }
 
 void Simulator::add_pool(std::shared_ptr<MiningPool> pool) {
   pools.push_back(pool);
 }
 
-std::shared_ptr<Miner> Simulator::get_miner(const std::string& miner_address) {
-  return miners[miner_address];
+std::shared_ptr<Miner> Simulator::get_miner(uint32_t miner_id) {
+  return miners[miner_id];
 }
 
 std::shared_ptr<Network> Simulator::get_network() const {
@@ -228,10 +391,49 @@ Event Simulator::get_next_event() const {
   return queue.get_top();
 }
 
+Event Simulator::pop_next_event() {
+  return queue.pop();
+}
+
+void Simulator::set_network_difficulty(uint64_t difficulty) {
+  network->set_difficulty(difficulty);
+  for (auto miner : miners) {
+    miner->refresh_scheduling();
+  }
+}
+
 void Simulator::process(const BlockEvent& block_event) {
+    POOLSIM_PROFILE_SCOPE(output);
+    if (block_events_count++ % simulation.output_config.block_interval != 0) {
+        return;
+    }
     BlockEvent block_event_copy = block_event;
     block_event_copy.time = network->current_time;
-    block_events.push_back(block_event_copy);
+    if (!(simulation.output_config.block_fields & BlockField::reward_scheme_data)) {
+        // not written, so not copied by the result writer either
+        block_event_copy.reward_scheme_data = nullptr;
+    }
+    get_result_writer().write_block(block_event_copy);
+}
+
+void Simulator::process(const HopEvent& hop_event) {
+    POOLSIM_PROFILE_SCOPE(output);
+    get_result_writer().write_hop(hop_event);
+}
+
+void Simulator::write_snapshots() {
+    POOLSIM_PROFILE_SCOPE(output);
+    for (auto pool : pools) {
+        PoolSnapshot snapshot {
+            .time = static_cast<double>(network->current_time),
+            .block = network->current_block,
+            .pool_name = pool->get_name(),
+            .blocks_mined = pool->get_blocks_mined(),
+            .miners_count = pool->get_miners_count(),
+            .luck = pool->get_luck()
+        };
+        get_result_writer().write_snapshot(snapshot);
+    }
 }
 
 }
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+namespace poolsim {
+
+// size of a cache line, to keep the producer and consumer indices apart
+const size_t cache_line_size = 64;
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread
+// Pushing to a full queue fails, it is up to the producer to wait
+template <typename T>
+class SPSCQueue {
+public:
+    // The capacity is rounded up to a power of two
+    explicit SPSCQueue(size_t capacity);
+
+    SPSCQueue(SPSCQueue const&) = delete;
+    void operator=(SPSCQueue const&) = delete;
+
+    // Called by the producer, returns false if the queue is full
+    bool try_push(const T& value);
+
+    // Called by the consumer, returns false if the queue is empty
+    bool try_pop(T& value);
+
+    // Returns the maximum number of values in the queue
+    size_t capacity() const;
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    // next slot to pop, only written by the consumer
+    std::atomic<size_t> head;
+    char head_padding[cache_line_size - sizeof(std::atomic<size_t>)];
+    // next slot to push, only written by the producer
+    std::atomic<size_t> tail;
+    char tail_padding[cache_line_size - sizeof(std::atomic<size_t>)];
+    // last head seen by the producer, to avoid reading head on every push
+    size_t producer_head = 0;
+    char producer_padding[cache_line_size - sizeof(size_t)];
+    // last tail seen by the consumer, to avoid reading tail on every pop
+    size_t consumer_tail = 0;
+};
+
+template <typename T>
+SPSCQueue<T>::SPSCQueue(size_t capacity) : head(0), tail(0) {
+    size_t size = 1;
+    while (size < capacity) {
+        size *= 2;
+    }
+    slots.resize(size);
+    mask = size - 1;
+}
+
+template <typename T>
+bool SPSCQueue<T>::try_push(const T& value) {
+    size_t current_tail = tail.load(std::memory_order_relaxed);
+    if (current_tail - producer_head == slots.size()) {
+        producer_head = head.load(std::memory_order_acquire);
+        if (current_tail - producer_head == slots.size()) {
+            return false;
+        }
+    }
+    slots[current_tail & mask] = value;
+    tail.store(current_tail + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::try_pop(T& value) {
+    size_t current_head = head.load(std::memory_order_relaxed);
+    if (current_head == consumer_tail) {
+        consumer_tail = tail.load(std::memory_order_acquire);
+        if (current_head == consumer_tail) {
+            return false;
+        }
+    }
+    value = slots[current_head & mask];
+    head.store(current_head + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+size_t SPSCQueue<T>::capacity() const {
+    return slots.size();
+}
+
+}
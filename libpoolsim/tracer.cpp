@@ -0,0 +1,144 @@
+#include <fstream>
+#include <stdexcept>
+
+#include "tracer.h"
+
+namespace poolsim {
+
+Tracer Tracer::instance;
+
+static std::atomic<uint32_t> next_thread_id{0};
+
+uint32_t get_trace_thread_id() {
+    static thread_local uint32_t thread_id = next_thread_id++;
+    return thread_id;
+}
+
+Tracer& Tracer::get_instance() {
+    return instance;
+}
+
+void Tracer::enable(uint64_t _interval) {
+    if (_interval == 0) {
+        throw std::invalid_argument("trace interval should be greater than 0");
+    }
+    interval = _interval;
+    origin = std::chrono::steady_clock::now();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+uint64_t Tracer::get_interval() const {
+    return interval;
+}
+
+uint64_t Tracer::now() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - origin).count();
+}
+
+void Tracer::add_event(TraceEvent event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(std::move(event));
+}
+
+void Tracer::set_thread_name(const std::string& name) {
+    if (!is_enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    thread_names[get_trace_thread_id()] = name;
+}
+
+void Tracer::write(const std::string& filepath) const {
+    std::ofstream file(filepath);
+    if (!file) {
+        throw std::invalid_argument("cannot open " + filepath);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    // one event per line, so that large traces can still be read by line based tools
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto& thread_name : thread_names) {
+        nlohmann::json metadata = {
+            {"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", thread_name.first},
+            {"args", {{"name", thread_name.second}}}
+        };
+        file << (first ? "" : ",\n") << metadata.dump();
+        first = false;
+    }
+    for (const TraceEvent& event : events) {
+        nlohmann::json j = {
+            {"name", event.name}, {"cat", event.category}, {"ph", "X"}, {"pid", 1},
+            {"tid", event.thread_id}, {"ts", event.start_microseconds}, {"dur", event.duration_microseconds}
+        };
+        if (!event.args.is_null()) {
+            j["args"] = event.args;
+        }
+        file << (first ? "" : ",\n") << j.dump();
+        first = false;
+    }
+    file << "\n]}\n";
+    if (!file) {
+        throw std::invalid_argument("cannot write " + filepath);
+    }
+}
+
+void Tracer::reset() {
+    enabled.store(false, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+    thread_names.clear();
+}
+
+const std::vector<TraceEvent>& Tracer::get_events() const {
+    return events;
+}
+
+TraceSpan::TraceSpan(const char* _category, std::string _name, nlohmann::json _args)
+    : active(Tracer::get_instance().is_enabled()), category(_category) {
+    if (active) {
+        name = std::move(_name);
+        args = std::move(_args);
+        start = Tracer::get_instance().now();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (!active) {
+        return;
+    }
+    Tracer& tracer = Tracer::get_instance();
+    tracer.add_event(TraceEvent{std::move(name), category, start, tracer.now() - start,
+                                get_trace_thread_id(), std::move(args)});
+}
+
+void TraceSpan::set_arg(const std::string& key, const nlohmann::json& value) {
+    if (active) {
+        args[key] = value;
+    }
+}
+
+TraceSampler::TraceSampler() {
+    Tracer& tracer = Tracer::get_instance();
+    interval = tracer.is_enabled() ? tracer.get_interval() : 0;
+    if (interval != 0) {
+        start = tracer.now();
+    }
+}
+
+TraceSampler::~TraceSampler() {
+    if (count > 0) {
+        flush();
+    }
+}
+
+void TraceSampler::flush() {
+    Tracer& tracer = Tracer::get_instance();
+    uint64_t end = tracer.now();
+    tracer.add_event(TraceEvent{"events", "run", start, end - start, get_trace_thread_id(),
+                                {{"events", count}}});
+    count = 0;
+    start = end;
+}
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace poolsim {
+
+// events of the event loop covered by each of its sampled spans
+const uint64_t default_trace_interval = 100000;
+
+// Span recorded by the tracer, written as a Chrome "complete" trace event
+struct TraceEvent {
+    std::string name;
+    const char* category;
+    uint64_t start_microseconds;
+    uint64_t duration_microseconds;
+    uint32_t thread_id;
+    nlohmann::json args;
+};
+
+// Returns a small ID for the calling thread, the track of its spans in the trace
+uint32_t get_trace_thread_id();
+
+// Records spans of the simulation to write them as Chrome trace event JSON,
+// which chrome://tracing and Perfetto open with one track per thread
+// Disabled by default, spans are then not recorded at all
+class Tracer {
+public:
+    static Tracer& get_instance();
+
+    // Starts recording, spans of the event loop covering interval events each
+    void enable(uint64_t interval = default_trace_interval);
+
+    bool is_enabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    uint64_t get_interval() const;
+
+    // Microseconds since the tracer was enabled
+    uint64_t now() const;
+
+    // Records a span, can be called from any thread
+    void add_event(TraceEvent event);
+
+    // Names the track of the calling thread, if enabled
+    void set_thread_name(const std::string& name);
+
+    // Writes the spans recorded so far to filepath
+    // Throws if the file cannot be written
+    void write(const std::string& filepath) const;
+
+    // Stops recording and clears the spans
+    void reset();
+
+    const std::vector<TraceEvent>& get_events() const;
+
+private:
+    static Tracer instance;
+
+    std::atomic<bool> enabled{false};
+    uint64_t interval = default_trace_interval;
+    std::chrono::steady_clock::time_point origin;
+
+    mutable std::mutex mutex;
+    std::vector<TraceEvent> events;
+    std::map<uint32_t, std::string> thread_names;
+};
+
+// Records a span from its construction to its destruction, if the tracer is enabled
+class TraceSpan {
+public:
+    TraceSpan(const char* category, std::string name, nlohmann::json args = nullptr);
+    ~TraceSpan();
+
+    TraceSpan(TraceSpan const&) = delete;
+    void operator=(TraceSpan const&) = delete;
+
+    // Adds an argument shown with the span
+    void set_arg(const std::string& key, const nlohmann::json& value);
+
+private:
+    bool active;
+    const char* category;
+    std::string name;
+    nlohmann::json args;
+    uint64_t start;
+};
+
+// Records a span for each interval events of an event loop
+// tick costs a single comparison when the tracer is disabled
+class TraceSampler {
+public:
+    TraceSampler();
+    ~TraceSampler();
+
+    TraceSampler(TraceSampler const&) = delete;
+    void operator=(TraceSampler const&) = delete;
+
+    void tick() {
+        if (interval != 0 && ++count == interval) {
+            flush();
+        }
+    }
+
+private:
+    // Records the span of the events counted since the last one
+    void flush();
+
+    uint64_t interval;
+    uint64_t count = 0;
+    uint64_t start = 0;
+};
+
+}
@@ -2,6 +2,8 @@
 script to retrieve data about a single miner from the simulation results
 
 usage: python get_miner_info.py /path/to/results MINER_ADDRESS
+
+poolsim-query computes the same results from the index written next to uncompressed results
 """
 
 import argparse
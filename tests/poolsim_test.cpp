@@ -11,10 +11,27 @@
 #include "random.h"
 #include "reward_scheme.h"
 #include "miner_record.h"
+#include "result_writer.h"
+#include "columnar.h"
+#include "gzip_stream.h"
+#include "async_result_writer.h"
+#include "spsc_queue.h"
+#include "result_index.h"
+#include "profiler.h"
+#include "allocation_tracker.h"
+#include "perf_counters.h"
+#include "tracer.h"
+#include "progress.h"
 #include <memory>
 #include <nlohmann/json.hpp>
 #include <vector>
 #include <iterator>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <zlib.h>
 
 
 using namespace poolsim;
@@ -132,11 +149,26 @@ const nlohmann::json random_miners_params = R"({
 class MockRandom : public Random {
 public:
     MOCK_METHOD0(drand48, double());
-    MOCK_METHOD0(get_address, std::string());
+    MOCK_METHOD0(get_address, Address());
     MOCK_METHOD2(random_int, int(int, int));
     MOCK_METHOD0(get_random_engine, std::shared_ptr<std::default_random_engine>());
 };
 
+// Random with its own state, so that runs with the same seed draw the same numbers
+class SeededRandom : public Random {
+public:
+    explicit SeededRandom(uint64_t seed)
+        : engine(seed), default_engine(std::make_shared<std::default_random_engine>(seed)) {}
+    double drand48() override { return std::uniform_real_distribution<double>(0, 1)(engine); }
+    uint64_t random_uint64() override { return engine(); }
+    Address get_address() override { return Address(); }
+    int random_int(int min, int max) override { return std::uniform_int_distribution<int>(min, max)(engine); }
+    std::shared_ptr<std::default_random_engine> get_random_engine() override { return default_engine; }
+private:
+    std::mt19937_64 engine;
+    std::shared_ptr<std::default_random_engine> default_engine;
+};
+
 class MockMiner : public Miner {
 public:
     MockMiner(const std::string& address, double hashrate, std::shared_ptr<Network> network)
@@ -155,13 +187,13 @@ public:
 
 class MockRewardScheme : public RewardScheme {
 public:
-    MOCK_METHOD2(handle_share, void(const std::string&, const Share&));
+    MOCK_METHOD2(handle_share, void(Address, const Share&));
     MOCK_METHOD0(get_json_metadata, nlohmann::json());
-    MOCK_METHOD1(get_miner_metadata, nlohmann::json (const std::string&));
-    MOCK_METHOD1(get_blocks_mined, uint64_t (const std::string&));
-    MOCK_METHOD1(get_blocks_received, double (const std::string&));
-    MOCK_METHOD1(handle_uncle, void(const std::string& miner_address));
-    MOCK_METHOD1(get_record, std::shared_ptr<MinerRecord> (const std::string&));
+    MOCK_METHOD1(get_miner_metadata, nlohmann::json (Address));
+    MOCK_METHOD1(get_blocks_mined, uint64_t (Address));
+    MOCK_METHOD1(get_blocks_received, double (Address));
+    MOCK_METHOD1(handle_uncle, void(Address miner_address));
+    MOCK_METHOD1(get_record, std::shared_ptr<MinerRecord> (Address));
     std::string get_scheme_name() const override { return "mock"; }
 };
 
@@ -216,11 +248,51 @@ TEST(SystemRandom, initialization) {
 }
 
 TEST(SystemRandom, get_address) {
-    auto address = SystemRandom::get_instance()->get_address();
+    auto address = SystemRandom::get_instance()->get_address().to_string();
     ASSERT_EQ(address.size(), 42);
     ASSERT_THAT(address, testing::MatchesRegex("0x[0-9a-f]{40}"));
 }
 
+TEST(Address, interning) {
+    Address address("0x7da82c7ab4771ff031b66538d2fb9b0b047f6cf9");
+    ASSERT_EQ(address, Address("0x7da82c7ab4771ff031b66538d2fb9b0b047f6cf9"));
+    ASSERT_EQ(address.to_string(), "0x7da82c7ab4771ff031b66538d2fb9b0b047f6cf9");
+    ASSERT_EQ(address.get_bytes()[0], 0x7d);
+    ASSERT_EQ(address.get_bytes()[19], 0xf9);
+    ASSERT_EQ(Address(address.get_bytes()), address);
+    ASSERT_NE(address, Address("0xaa1a6e3e6ef20068f7f8d8c835d2d22fd5116444"));
+
+    Address label("miner_A");
+    ASSERT_EQ(label, Address("miner_A"));
+    ASSERT_EQ(label.to_string(), "miner_A");
+    // only lowercase hex addresses are canonical, so that they print as they were given
+    ASSERT_EQ(Address("0x7DA82C7AB4771FF031B66538D2FB9B0B047F6CF9").to_string(),
+              "0x7DA82C7AB4771FF031B66538D2FB9B0B047F6CF9");
+
+    ASSERT_TRUE(Address().is_null());
+    ASSERT_EQ(Address().to_string(), "");
+    nlohmann::json j = address;
+    ASSERT_EQ(j, "0x7da82c7ab4771ff031b66538d2fb9b0b047f6cf9");
+}
+
+TEST(Address, order) {
+    // interned in another order than the one of their strings
+    Address high("0xff00000000000000000000000000000000000000");
+    Address low("0x0a00000000000000000000000000000000000000");
+    Address label("0xzz_label");
+    ASSERT_TRUE(low < high);
+    ASSERT_FALSE(high < low);
+    ASSERT_TRUE(high < label);
+    ASSERT_TRUE(Address() < low);
+    ASSERT_FALSE(low < Address());
+
+    PoolMembership members;
+    members.insert(label);
+    members.insert(high);
+    members.insert(low);
+    ASSERT_EQ(members.get_sorted(), std::vector<Address>({low, high, label}));
+}
+
 TEST(Random, random_element) {
     std::vector<std::shared_ptr<MinerRecord>> records;
     for (size_t i = 0; i < 3; i++) {
@@ -281,6 +353,35 @@ TEST(Simulation, from_string) {
     ASSERT_EQ(miner_config.params["path"], "miners.csv");
 }
 
+TEST(Simulation, output_options) {
+    auto simulation = Simulation::from_string(simulation_string);
+    ASSERT_TRUE(simulation.output_config.blocks);
+    ASSERT_EQ(simulation.output_config.block_fields, BlockField::all);
+    ASSERT_EQ(simulation.output_config.block_interval, 1);
+
+    auto config = nlohmann::json::parse(simulation_string);
+    config["output_options"] = R"({
+        "detail": "summary",
+        "block_fields": ["time", "miner_address"],
+        "block_interval": 10,
+        "hop_events": false,
+        "encoding": "dictionary"
+    })"_json;
+    simulation = config.get<Simulation>();
+    ASSERT_FALSE(simulation.output_config.blocks);
+    ASSERT_EQ(simulation.output_config.block_fields, BlockField::time | BlockField::miner_address);
+    ASSERT_EQ(simulation.output_config.block_interval, 10);
+    ASSERT_FALSE(simulation.output_config.hop_events);
+    ASSERT_TRUE(simulation.output_config.dictionary_encoding);
+
+    config["output_options"] = R"({"block_fields": ["unknown"]})"_json;
+    ASSERT_THROW(config.get<Simulation>(), std::invalid_argument);
+    config["output_options"] = R"({"block_interval": 0})"_json;
+    ASSERT_THROW(config.get<Simulation>(), std::invalid_argument);
+    config["output_options"] = R"({"encoding": "unknown"})"_json;
+    ASSERT_THROW(config.get<Simulation>(), std::invalid_argument);
+}
+
 TEST(Network, setters_getters) {
     auto network = std::make_shared<Network>(1000);
     ASSERT_EQ(network->get_difficulty(), 1000);
@@ -363,6 +464,66 @@ TEST(Miner, join_pool) {
     ASSERT_EQ(miner->get_pool(), pool2);
     miner->join_pool(pool1);
     ASSERT_EQ(pool1->get_miners_count(), 1);
+    ASSERT_TRUE(pool1->has_miner(miner->get_address()));
+    ASSERT_FALSE(pool1->has_miner(Address("other_address")));
+}
+
+TEST(PoolMembership, insert) {
+    PoolMembership members;
+    Address first("member_first"), second("member_second");
+    ASSERT_EQ(members.size(), 0);
+    ASSERT_FALSE(members.contains(first));
+    ASSERT_TRUE(members.insert(second));
+    ASSERT_TRUE(members.insert(first));
+    ASSERT_FALSE(members.insert(second));
+    ASSERT_EQ(members.size(), 2);
+    ASSERT_TRUE(members.contains(first));
+    ASSERT_TRUE(members.contains(second));
+    ASSERT_FALSE(members.contains(Address("member_other")));
+    std::vector<Address> addresses(members.begin(), members.end());
+    ASSERT_EQ(addresses, std::vector<Address>({second, first}));
+    ASSERT_THROW(members.insert(Address()), std::invalid_argument);
+
+    // the bytes held by a pool only depend on its own members
+    PoolMembership sparse;
+    for (uint32_t id = 0; id < 100; id++) {
+        ASSERT_TRUE(sparse.insert(Address::from_id(50000000 + 1000 * id)));
+    }
+    ASSERT_TRUE(sparse.contains(Address::from_id(50099000)));
+    ASSERT_FALSE(sparse.contains(Address::from_id(50099001)));
+    ASSERT_LE(sparse.get_memory_usage(), 2000);
+}
+
+TEST(Miner, scheduling) {
+    auto network = get_sample_network();
+    auto miner = Miner::create("random_address", 25, get_mock_share_handler(), network);
+    auto pool1 = MiningPool::create("pool1", 50, 0.001, get_mock_reward_scheme(), network);
+    auto pool2 = MiningPool::create("pool2", 10, 0.001, get_mock_reward_scheme(), network);
+    miner->join_pool(pool1);
+    ASSERT_FLOAT_EQ(miner->get_scheduling().share_interval, 2);
+    // 50 / 100 = 0.5
+    ASSERT_EQ(miner->get_scheduling().block_threshold, 1ULL << 63);
+    miner->join_pool(pool2);
+    ASSERT_FLOAT_EQ(miner->get_scheduling().share_interval, 0.4);
+    ASSERT_NEAR(miner->get_scheduling().block_threshold / 18446744073709551616.0, 0.1, 1e-12);
+}
+
+TEST(Miner, move_to_table) {
+    auto network = get_sample_network();
+    MinerTable table;
+    table.add(MinerState());
+    auto miner = Miner::create("random_address", 25, get_mock_share_handler(), network);
+    auto pool = MiningPool::create("pool", 50, 0.001, get_mock_reward_scheme(), network);
+    miner->join_pool(pool);
+    miner->process_share(Share(Share::Property::valid_block));
+    miner->move_to_table(table);
+    ASSERT_EQ(miner->get_id(), 1);
+    ASSERT_EQ(table.size(), 2);
+    ASSERT_EQ(table[1].total_work, 50);
+    ASSERT_EQ(miner->get_blocks_found(), 1);
+    ASSERT_FLOAT_EQ(miner->get_hashrate(), 25);
+    miner->process_share(Share(Share::Property::none));
+    ASSERT_EQ(table[1].total_work, 100);
 }
 
 TEST(Miner, handle_share) {
@@ -391,6 +552,38 @@ TEST(Miner, handle_share) {
     ASSERT_EQ(miner->get_blocks_found(), 1);
 }
 
+TEST(ShareHandler, flyweight) {
+    auto args = R"({"top_n": 1, "threshold": 0.9, "addresses": 2})"_json;
+    auto default_handler = create_share_handler("default", args);
+    ASSERT_TRUE(default_handler->is_flyweight());
+    ASSERT_EQ(create_share_handler("default", args), default_handler);
+    auto multiple_addresses_handler = create_share_handler("multiple_addresses", args);
+    ASSERT_FALSE(multiple_addresses_handler->is_flyweight());
+    ASSERT_NE(create_share_handler("multiple_addresses", args), multiple_addresses_handler);
+
+    auto reward_scheme = get_mock_reward_scheme();
+    MockRewardScheme* reward_scheme_ptr = reward_scheme.get();
+    auto network = get_sample_network();
+    auto pool = MiningPool::create("pool", 100, 0, std::move(reward_scheme), network);
+    auto miner_a = Miner::create("address_A", 10, default_handler, network);
+    auto miner_b = Miner::create("address_B", 10, default_handler, network);
+    miner_a->join_pool(pool);
+    miner_b->join_pool(pool);
+    EXPECT_CALL(*reward_scheme_ptr, handle_share(Address("address_A"), Share(Share::Property::none)));
+    miner_a->process_share(Share(Share::Property::none));
+    EXPECT_CALL(*reward_scheme_ptr, handle_share(Address("address_B"), Share(Share::Property::none)));
+    miner_b->process_share(Share(Share::Property::none));
+
+    // a flyweight has no miner of its own to handle the share of
+    ASSERT_THROW(default_handler->handle_share(Share(Share::Property::none)), std::logic_error);
+    ASSERT_THROW(default_handler->get_pool(), std::logic_error);
+    ASSERT_THROW(default_handler->get_address(), std::logic_error);
+
+    // flyweights are shared by handlers with the same args only
+    auto other_args = R"({"top_n": 2})"_json;
+    ASSERT_NE(create_share_handler("default", other_args), default_handler);
+    ASSERT_EQ(create_share_handler("default", args), default_handler);
+}
 
 TEST(MiningPool, submit_share) {
     auto reward_scheme = get_mock_reward_scheme();
@@ -399,18 +592,75 @@ TEST(MiningPool, submit_share) {
 
     auto pool = MiningPool::create("pool", 100, 0.3, std::move(reward_scheme), get_sample_network(), random);
 
-    EXPECT_CALL(*reward_scheme_ptr, handle_share("address", Share(Share::Property::none)));
+    EXPECT_CALL(*reward_scheme_ptr, handle_share(Address("address"), Share(Share::Property::none)));
     pool->submit_share("address", Share(Share::Property::none));
 
     EXPECT_CALL(*random, drand48()).WillOnce(testing::Return(0.5));
-    EXPECT_CALL(*reward_scheme_ptr, handle_share("address", Share(Share::Property::valid_block)));
+    EXPECT_CALL(*reward_scheme_ptr, handle_share(Address("address"), Share(Share::Property::valid_block)));
     pool->submit_share("address", Share(Share::Property::valid_block));
 
     EXPECT_CALL(*random, drand48()).WillOnce(testing::Return(0.2));
-    EXPECT_CALL(*reward_scheme_ptr, handle_share("address", Share(Share::Property::valid_block | Share::Property::uncle)));
+    EXPECT_CALL(*reward_scheme_ptr, handle_share(Address("address"), Share(Share::Property::valid_block | Share::Property::uncle)));
     pool->submit_share("address", Share(Share::Property::valid_block));
 }
 
+static std::shared_ptr<MiningPool> get_pool_with_miners(std::shared_ptr<Network> network, size_t miners_count) {
+    auto pool = MiningPool::create("pool", 100, 0, RewardSchemeFactory::create("pps", nlohmann::json::object()), network);
+    for (size_t i = 0; i < miners_count; i++) {
+        Address address("scale_miner_" + std::to_string(i));
+        pool->join(address);
+        pool->submit_share(address, Share(Share::Property::none));
+    }
+    return pool;
+}
+
+// PPS scheme counting the miner metadata it is asked to write
+class CountingPPSRewardScheme : public PPSRewardScheme {
+public:
+    CountingPPSRewardScheme() : PPSRewardScheme(nlohmann::json::object()) {}
+    void write_miner_metadata(JSONWriter& writer, Address miner_address) override {
+        lookups++;
+        PPSRewardScheme::write_miner_metadata(writer, miner_address);
+    }
+    uint64_t lookups = 0;
+};
+
+TEST(MiningPool, write_miners_metadata) {
+    auto network = get_sample_network();
+    auto pool = get_pool_with_miners(network, 3);
+    std::ostringstream output;
+    {
+        JSONWriter writer(output);
+        pool->write_miners_metadata(writer);
+    }
+    ASSERT_EQ(output.str(), pool->get_miners_metadata().dump());
+
+    // each miner is looked up once, see BM_MiningPool_write_miners_metadata for the timings
+    auto reward_scheme = new CountingPPSRewardScheme();
+    auto counted_pool = MiningPool::create("pool", 100, 0, std::unique_ptr<RewardScheme>(reward_scheme), network);
+    for (size_t i = 0; i < 1000; i++) {
+        Address address("counted_miner_" + std::to_string(i));
+        counted_pool->join(address);
+        counted_pool->submit_share(address, Share(Share::Property::none));
+    }
+    {
+        std::ostringstream counted_output;
+        JSONWriter writer(counted_output);
+        counted_pool->write_miners_metadata(writer);
+    }
+    ASSERT_EQ(reward_scheme->lookups, 1000);
+
+    // the record index only grows with the records of the pool, not with address IDs
+    PPSRewardScheme sparse_scheme(nlohmann::json::object());
+    sparse_scheme.set_mining_pool(counted_pool);
+    for (uint32_t i = 0; i < 10; i++) {
+        sparse_scheme.handle_share(Address::from_id(50000000 + 1000 * i), Share(Share::Property::none));
+    }
+    MemoryUsage usage;
+    sparse_scheme.add_memory_usage(usage);
+    ASSERT_LT(usage["records.PPS"], 10 * 300);
+}
+
 TEST(QBRewardScheme, update_record) {
     auto simulation = Simulation::from_string(qb_simulation_string);
     ASSERT_EQ(simulation.pools.size(), 1);
@@ -670,15 +920,15 @@ TEST(PROPRewardScheme, handle_share) {
 TEST(EventQueue, events_ordering) {
     EventQueue eq;
     ASSERT_TRUE(eq.is_empty());
-    eq.schedule(Event("ev1", 2));
+    eq.schedule(Event(1, 2));
     ASSERT_FALSE(eq.is_empty());
-    eq.schedule(Event("ev2", 1));
-    eq.schedule(Event("ev3", 5));
-    eq.schedule(Event("ev4", 4));
-    ASSERT_EQ(eq.pop().miner_address, "ev2");
-    ASSERT_EQ(eq.pop().miner_address, "ev1");
-    ASSERT_EQ(eq.pop().miner_address, "ev4");
-    ASSERT_EQ(eq.pop().miner_address, "ev3");
+    eq.schedule(Event(2, 1));
+    eq.schedule(Event(3, 5));
+    eq.schedule(Event(4, 4));
+    ASSERT_EQ(eq.pop().miner_id, 2);
+    ASSERT_EQ(eq.pop().miner_id, 1);
+    ASSERT_EQ(eq.pop().miner_id, 4);
+    ASSERT_EQ(eq.pop().miner_id, 3);
 }
 
 TEST(Simulator, schedule_miner) {
@@ -693,7 +943,7 @@ TEST(Simulator, schedule_miner) {
     simulator->schedule_miner(miner);
     ASSERT_NE(simulator->get_events_count(), 0);
     auto event = simulator->get_next_event();
-    ASSERT_EQ(event.miner_address, "address");
+    ASSERT_EQ(event.miner_id, miner->get_id());
     // 25 / 50 = 0.5
     ASSERT_FLOAT_EQ(event.time, -log(0.3) / 0.5);
 }
@@ -709,7 +959,8 @@ TEST(Simulator, process_event) {
     miner->join_pool(pool);
 
     simulator->add_miner(miner);
-    Event event(miner->get_address(), 5);
+    ASSERT_EQ(simulator->get_miner(miner->get_id()), miner);
+    Event event(miner->get_id(), 5);
     ASSERT_EQ(network->get_current_block(), 0);
     ASSERT_EQ(network->get_current_time(), 0);
     // drand48() called once in process_event and once in schedule_miner
@@ -720,7 +971,7 @@ TEST(Simulator, process_event) {
     ASSERT_EQ(network->get_current_block(), 1);
     ASSERT_EQ(network->get_current_time(), 5);
 
-    Event event2(miner->get_address(), 10);
+    Event event2(miner->get_id(), 10);
     EXPECT_CALL(*random, drand48()).Times(2).WillRepeatedly(testing::Return(0.8));
     // 0.8 > 0.5 -> not network share
     EXPECT_CALL(*miner, process_share(Share(Share::Property::none))).Times(1);
@@ -737,6 +988,131 @@ TEST(Simulator, initialize) {
     ASSERT_EQ(simulator->get_network()->get_pools().size(), 1);
 }
 
+TEST(Simulator, is_specialized) {
+    auto simulator = get_sample_simulator();
+    ASSERT_FALSE(simulator->is_specialized());
+    simulator->initialize();
+    ASSERT_TRUE(simulator->is_specialized());
+
+    auto simulation = get_sample_simulation();
+    auto pool_config = simulation.pools[0];
+    pool_config.reward_scheme_config.scheme_type = "prop";
+    simulation.pools.push_back(pool_config);
+    auto mixed_simulator = std::make_shared<Simulator>(simulation);
+    mixed_simulator->initialize();
+    ASSERT_FALSE(mixed_simulator->is_specialized());
+}
+
+// Runs a QB simulation whose miners all use the given behavior and returns its results
+static nlohmann::json run_simulation_with_kernel(const nlohmann::json& behavior, bool specialized) {
+    auto simulation_json = nlohmann::json::parse(qb_simulation_string);
+    simulation_json["output"] = "results_kernel.json";
+    simulation_json["blocks"] = 30;
+    // uncles are drawn from SystemRandom, which cannot be seeded again
+    simulation_json["pools"][0]["uncle_block_prob"] = 0;
+    nlohmann::json miners = nlohmann::json::array();
+    for (int i = 0; i < 20; i++) {
+        miners.push_back({{"address", "kernel_miner_" + std::to_string(i)},
+                          {"hashrate", 1 + i % 7}, {"behavior", behavior}});
+    }
+    simulation_json["pools"][0]["miners"] = {{{"generator", "inline"}, {"params", {{"miners", miners}}}}};
+
+    auto simulator = std::make_shared<Simulator>(simulation_json.get<Simulation>(),
+                                                 std::make_shared<SeededRandom>(42));
+    if (!specialized) {
+        simulator->disable_specialization();
+    }
+    simulator->run();
+    EXPECT_EQ(simulator->is_specialized(), specialized);
+    simulator->save_simulation_data();
+
+    std::ifstream results_file("results_kernel.json");
+    nlohmann::json results = nlohmann::json::parse(results_file);
+    results.erase("runtime_milliseconds");
+    std::remove("results_kernel.json");
+    std::remove("results_kernel.json.idx");
+    return results;
+}
+
+TEST(Simulator, specialized_kernel_results) {
+    std::vector<nlohmann::json> behaviors = {
+        {{"name", "default"}},
+        {{"name", "share_withholding"}},
+        {{"name", "share_donation"}, {"params", {{"top_n", 3}, {"threshold", 0.5}}}}
+    };
+    for (const nlohmann::json& behavior : behaviors) {
+        SCOPED_TRACE(behavior.dump());
+        nlohmann::json specialized = run_simulation_with_kernel(behavior, true);
+        nlohmann::json generic = run_simulation_with_kernel(behavior, false);
+        uint64_t blocks_found = 0;
+        for (const nlohmann::json& miner : specialized["miners"]) {
+            blocks_found += miner["blocks_found"].get<uint64_t>();
+        }
+        ASSERT_EQ(blocks_found, 30);
+        ASSERT_EQ(specialized, generic);
+    }
+}
+
+TEST(Simulator, dictionary_encoded_hop_events) {
+    auto simulation_json = nlohmann::json::parse(qb_simulation_string);
+    simulation_json["blocks"] = 200;
+    simulation_json["output_options"] = {{"encoding", "dictionary"}};
+    nlohmann::json pool = simulation_json["pools"][0];
+    pool["uncle_block_prob"] = 0;
+    simulation_json["pools"] = nlohmann::json::array();
+    for (int i = 0; i < 2; i++) {
+        nlohmann::json miners = {{{"address", "hop_pool_miner_" + std::to_string(i)}, {"hashrate", 10}}};
+        if (i == 0) {
+            miners.push_back({{"address", "hopping_miner"}, {"hashrate", 5},
+                              {"behavior", {{"name", "qb_luck_pool_hopping"}, {"params", {{"bad_luck_limit", 1}}}}}});
+        }
+        pool["name"] = "hop_pool_" + std::to_string(i);
+        pool["miners"] = {{{"generator", "inline"}, {"params", {{"miners", miners}}}}};
+        simulation_json["pools"].push_back(pool);
+    }
+
+    for (const std::string output : {"results_hops.json", "results_hops.ndjson"}) {
+        SCOPED_TRACE(output);
+        simulation_json["output"] = output;
+        auto simulator = std::make_shared<Simulator>(simulation_json.get<Simulation>(),
+                                                     std::make_shared<SeededRandom>(7));
+        simulator->run();
+        simulator->save_simulation_data();
+
+        std::vector<std::string> pool_names;
+        nlohmann::json hopping_miner;
+        std::ifstream input(output);
+        if (output == "results_hops.json") {
+            nlohmann::json results = nlohmann::json::parse(input);
+            pool_names = results["dictionary"]["pool_names"].get<std::vector<std::string>>();
+            hopping_miner = results["miners"][1];
+        } else {
+            std::string line;
+            while (std::getline(input, line)) {
+                nlohmann::json j = nlohmann::json::parse(line);
+                if (j["type"] == "pool_name") {
+                    pool_names.push_back(j["value"]);
+                } else if (j["type"] == "miner" && j["address"] == "hopping_miner") {
+                    hopping_miner = j;
+                }
+            }
+        }
+        ASSERT_EQ(hopping_miner["address"], "hopping_miner");
+        const nlohmann::json& hop_events = hopping_miner["handler_metadata"]["hop_events"];
+        ASSERT_GT(hop_events.size(), 0);
+        for (const nlohmann::json& event : hop_events) {
+            ASSERT_EQ(event.count("previous_pool"), 0);
+            ASSERT_LT(event["previous_pool_id"].get<size_t>(), pool_names.size());
+            ASSERT_LT(event["next_pool_id"].get<size_t>(), pool_names.size());
+            ASSERT_NE(event["previous_pool_id"], event["next_pool_id"]);
+        }
+        ASSERT_EQ(pool_names[hop_events[0]["previous_pool_id"].get<size_t>()], "hop_pool_0");
+        input.close();
+        std::remove(output.c_str());
+        std::remove((output + ".idx").c_str());
+    }
+}
+
 TEST(Simulator, schedule_all) {
     auto simulator = get_sample_simulator();
     simulator->initialize();
@@ -745,6 +1121,683 @@ TEST(Simulator, schedule_all) {
     ASSERT_EQ(simulator->get_events_count(), 100);
 }
 
+TEST(Simulator, get_memory_usage) {
+    auto simulator = get_sample_simulator();
+    simulator->initialize();
+    simulator->schedule_all();
+    MemoryUsage usage = simulator->get_memory_usage();
+    ASSERT_EQ(usage["event_queue"], 100 * sizeof(Event));
+    ASSERT_GE(usage["miners"], 100 * sizeof(Miner));
+    ASSERT_GE(usage["pool_members"], 100 * sizeof(Address));
+    ASSERT_GE(usage["addresses"], 100 * sizeof(AddressBytes));
+    ASSERT_TRUE(usage.find("hop_events") == usage.end());
+
+    auto network = get_sample_network();
+    PPLNSRewardScheme reward_scheme(nlohmann::json({{"n", 10}}));
+    auto pool = MiningPool::create("pool", 50, 0, get_mock_reward_scheme(), network);
+    reward_scheme.set_mining_pool(pool);
+    for (int i = 0; i < 15; i++) {
+        reward_scheme.handle_share(Address("pplns_memory_" + std::to_string(i % 5)), Share(Share::Property::none));
+    }
+    MemoryUsage scheme_usage;
+    reward_scheme.add_memory_usage(scheme_usage);
+    ASSERT_EQ(scheme_usage["pplns_window"], 10 * (sizeof(Address) + list_node_overhead));
+    ASSERT_GE(scheme_usage["records." + reward_scheme.get_scheme_name()], 5 * sizeof(MinerRecord));
+}
+
+TEST(JSONWriter, matches_nlohmann) {
+    nlohmann::json metadata = {{"nested", {1, 2}}, {"empty", nlohmann::json::object()}};
+    nlohmann::json expected = {
+        {"address", Address("0x7da82c7ab4771ff031b66538d2fb9b0b047f6cf9")},
+        {"empty", nlohmann::json::array()},
+        {"flag", true},
+        {"metadata", metadata},
+        {"name", "quote\" and \\ \n\x01"},
+        {"numbers", {0.1, 1.0, 1e-7, uint64_t(18446744073709551615ULL), int64_t(-3)}},
+        {"unset", nullptr}
+    };
+    for (int indent : {-1, 4}) {
+        std::stringstream output;
+        {
+            JSONWriter writer(output, indent);
+            writer.start_object();
+            writer.key("address");
+            writer.value(Address("0x7da82c7ab4771ff031b66538d2fb9b0b047f6cf9"));
+            writer.key("empty");
+            writer.start_array();
+            writer.end_array();
+            writer.key("flag");
+            writer.value(true);
+            writer.key("metadata");
+            writer.value(metadata);
+            writer.key("name");
+            writer.value("quote\" and \\ \n\x01");
+            writer.key("numbers");
+            writer.start_array();
+            writer.value(0.1);
+            writer.value(1.0);
+            writer.value(1e-7);
+            writer.value(uint64_t(18446744073709551615ULL));
+            writer.value(int64_t(-3));
+            writer.end_array();
+            writer.key("unset");
+            writer.value(nullptr);
+            writer.end_object();
+        }
+        ASSERT_EQ(output.str(), expected.dump(indent));
+    }
+}
+
+TEST(GzipOutputStream, round_trip) {
+    std::string expected;
+    for (int i = 0; i < 20000; i++) {
+        expected += "{\"block\": " + std::to_string(i * 7919 % 10007) + "}\n";
+    }
+    {
+        // small blocks so that the input is spread over all the threads
+        GzipOutputStream output("results.json.gz", 4, 4096);
+        output << expected.substr(0, 1000);
+        output.write(expected.data() + 1000, expected.size() - 1000);
+        output.close();
+    }
+
+    gzFile file = gzopen("results.json.gz", "rb");
+    ASSERT_NE(file, nullptr);
+    std::string actual;
+    char buffer[8192];
+    int size;
+    while ((size = gzread(file, buffer, sizeof(buffer))) > 0) {
+        actual.append(buffer, size);
+    }
+    ASSERT_EQ(size, 0);
+    ASSERT_EQ(gzclose(file), Z_OK);
+    ASSERT_EQ(actual, expected);
+    std::remove("results.json.gz");
+}
+
+TEST(ResultWriter, ndjson) {
+    auto writer = ResultWriter::create("results.ndjson");
+    QBBlockMetaData block_data;
+    block_data.shares_per_block = 7;
+    block_data.receiver_address = Address("receiver");
+    const std::string pool_name = "pool";
+    BlockEvent block_event {
+        .time = 1.5,
+        .is_uncle = false,
+        .pool_name = &pool_name,
+        .miner_address = Address("address"),
+        .reward_scheme_data_type = BlockDataType::qb,
+        .reward_scheme_data = &block_data
+    };
+    writer->write_block(block_event);
+    writer->finish(12, {}, {});
+
+    std::ifstream input("results.ndjson");
+    std::string line;
+    std::vector<nlohmann::json> lines;
+    while (std::getline(input, line)) {
+        lines.push_back(nlohmann::json::parse(line));
+    }
+    ASSERT_EQ(lines.size(), 2);
+    ASSERT_EQ(lines[0]["type"], "block");
+    ASSERT_EQ(lines[0]["time"], 1.5);
+    ASSERT_EQ(lines[0]["miner_address"], "address");
+    ASSERT_EQ(lines[0]["reward_scheme_data"]["shares_per_block"], 7);
+    ASSERT_EQ(lines[0]["reward_scheme_data"]["receiver_address"], "receiver");
+    ASSERT_EQ(lines[1]["type"], "summary");
+    ASSERT_EQ(lines[1]["runtime_milliseconds"], 12);
+    std::remove("results.ndjson");
+    std::remove("results.ndjson.idx");
+}
+
+TEST(SPSCQueue, producer_consumer) {
+    SPSCQueue<uint64_t> queue(100);
+    ASSERT_EQ(queue.capacity(), 128);
+    uint64_t value;
+    ASSERT_FALSE(queue.try_pop(value));
+
+    const uint64_t count = 100000;
+    std::thread producer([&queue, count] {
+        for (uint64_t i = 0; i < count; i++) {
+            while (!queue.try_push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (uint64_t expected = 0; expected < count; expected++) {
+        while (!queue.try_pop(value)) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(value, expected);
+    }
+    producer.join();
+    ASSERT_FALSE(queue.try_pop(value));
+}
+
+TEST(ResultWriter, async) {
+    // a small queue so that the writer thread applies backpressure
+    AsyncResultWriter writer(ResultWriter::create("results_async.ndjson"), 4);
+    QBBlockMetaData block_data;
+    block_data.receiver_address = Address("receiver");
+    const std::string pool_names[] = {"pool-0", "pool-1"};
+    for (uint64_t i = 0; i < 1000; i++) {
+        block_data.shares_per_block = i;
+        BlockEvent block_event {
+            .time = static_cast<double>(i),
+            .is_uncle = false,
+            .pool_name = &pool_names[i % 2],
+            .miner_address = Address("address"),
+            .reward_scheme_data_type = BlockDataType::qb,
+            .reward_scheme_data = &block_data
+        };
+        writer.write_block(block_event);
+    }
+    writer.write_hop(HopEvent {
+        .previous_pool = "pool-0",
+        .next_pool = "pool-1",
+        .time = 1000,
+        .miner_address = Address("address")
+    });
+    writer.write_snapshot(PoolSnapshot {
+        .time = 1001,
+        .block = 1000,
+        .pool_name = "pool-1",
+        .blocks_mined = 500,
+        .miners_count = 2,
+        .luck = 0.5
+    });
+    writer.finish(12, {}, {});
+
+    std::ifstream input("results_async.ndjson");
+    std::string line;
+    std::vector<nlohmann::json> lines;
+    while (std::getline(input, line)) {
+        lines.push_back(nlohmann::json::parse(line));
+    }
+    ASSERT_EQ(lines.size(), 1003);
+    for (uint64_t i = 0; i < 1000; i++) {
+        ASSERT_EQ(lines[i]["type"], "block");
+        ASSERT_EQ(lines[i]["time"], i);
+        ASSERT_EQ(lines[i]["pool_name"], i % 2 == 0 ? "pool-0" : "pool-1");
+        ASSERT_EQ(lines[i]["reward_scheme_data"]["shares_per_block"], i);
+        ASSERT_EQ(lines[i]["reward_scheme_data"]["receiver_address"], "receiver");
+    }
+    ASSERT_EQ(lines[1000]["type"], "hop");
+    ASSERT_EQ(lines[1000]["next_pool"], "pool-1");
+    ASSERT_EQ(lines[1000]["miner_address"], "address");
+    ASSERT_EQ(lines[1001]["type"], "snapshot");
+    ASSERT_EQ(lines[1001]["blocks_mined"], 500);
+    ASSERT_EQ(lines[1002]["type"], "summary");
+    std::remove("results_async.ndjson");
+    std::remove("results_async.ndjson.idx");
+}
+
+// Result writer failing on every block, as when the disk is full
+class FailingResultWriter : public ResultWriter {
+public:
+    void write_block(const BlockEvent& block_event) override { throw std::runtime_error("disk full"); }
+    void finish(int64_t runtime_milliseconds,
+                const std::vector<std::shared_ptr<MiningPool>>& pools,
+                const std::vector<std::shared_ptr<Miner>>& miners) override {}
+};
+
+TEST(ResultWriter, async_errors) {
+    const std::string pool_name = "pool-0";
+    BlockEvent block_event {
+        .time = 0,
+        .is_uncle = false,
+        .pool_name = &pool_name,
+        .miner_address = Address("address"),
+        .reward_scheme_data_type = BlockDataType::basic,
+        .reward_scheme_data = nullptr
+    };
+
+    // the error of the writer thread fails the next writes rather than only finish
+    AsyncResultWriter failing_writer(std::unique_ptr<ResultWriter>(new FailingResultWriter()), 4);
+    bool thrown = false;
+    for (int i = 0; i < 100000 && !thrown; i++) {
+        try {
+            failing_writer.write_block(block_event);
+        } catch (const std::runtime_error& e) {
+            ASSERT_STREQ(e.what(), "disk full");
+            thrown = true;
+        }
+    }
+    ASSERT_TRUE(thrown);
+    ASSERT_THROW(failing_writer.finish(0, {}, {}), std::runtime_error);
+
+    // nothing but finish can follow the profile, which stops the writer thread
+    AsyncResultWriter writer(std::unique_ptr<ResultWriter>(new FailingResultWriter()), 4);
+    writer.write_profile(Profiler::get_instance());
+    ASSERT_THROW(writer.write_block(block_event), std::logic_error);
+    ASSERT_NO_THROW(writer.finish(0, {}, {}));
+}
+
+TEST(ResultWriter, block_fields) {
+    auto writer = ResultWriter::create("results_fields.ndjson", false, BlockField::time | BlockField::pool_name);
+    BlockMetaData block_data;
+    const std::string pool_name = "pool";
+    BlockEvent block_event {
+        .time = 2,
+        .is_uncle = false,
+        .pool_name = &pool_name,
+        .miner_address = Address("address"),
+        .reward_scheme_data_type = BlockDataType::basic,
+        .reward_scheme_data = &block_data
+    };
+    writer->write_block(block_event);
+    writer->finish(12, {}, {});
+
+    std::ifstream input("results_fields.ndjson");
+    std::string line;
+    std::getline(input, line);
+    ASSERT_EQ(line, R"({"type":"block","pool_name":"pool","time":2.0})");
+    std::remove("results_fields.ndjson");
+    std::remove("results_fields.ndjson.idx");
+}
+
+TEST(ResultWriter, dictionary_encoding) {
+    QBBlockMetaData block_data;
+    block_data.receiver_address = Address("receiver");
+    const std::string pool_name = "pool";
+    BlockEvent block_event {
+        .time = 1.5,
+        .is_uncle = false,
+        .pool_name = &pool_name,
+        .miner_address = Address("address"),
+        .reward_scheme_data_type = BlockDataType::qb,
+        .reward_scheme_data = &block_data
+    };
+    HopEvent hop_event {
+        .previous_pool = "pool",
+        .next_pool = "other_pool",
+        .time = 2,
+        .miner_address = Address("address")
+    };
+
+    auto writer = ResultWriter::create("results_dictionary.ndjson", false, BlockField::all, true);
+    writer->write_block(block_event);
+    writer->write_hop(hop_event);
+    writer->write_block(block_event);
+    writer->finish(12, {}, {});
+    std::ifstream input("results_dictionary.ndjson");
+    std::string line;
+    std::vector<nlohmann::json> lines;
+    while (std::getline(input, line)) {
+        lines.push_back(nlohmann::json::parse(line));
+    }
+    ASSERT_EQ(lines.size(), 8);
+    ASSERT_EQ(lines[0], R"({"type": "pool_name", "id": 0, "value": "pool"})"_json);
+    ASSERT_EQ(lines[1], R"({"type": "address", "id": 0, "value": "address"})"_json);
+    ASSERT_EQ(lines[2], R"({"type": "address", "id": 1, "value": "receiver"})"_json);
+    ASSERT_EQ(lines[3]["pool_id"], 0);
+    ASSERT_EQ(lines[3]["miner_id"], 0);
+    ASSERT_EQ(lines[3]["reward_scheme_data"]["receiver_id"], 1);
+    ASSERT_EQ(lines[3].count("pool_name"), 0);
+    ASSERT_EQ(lines[4], R"({"type": "pool_name", "id": 1, "value": "other_pool"})"_json);
+    ASSERT_EQ(lines[5], R"({"type": "hop", "miner_id": 0, "next_pool_id": 1, "previous_pool_id": 0, "time": 2})"_json);
+    ASSERT_EQ(lines[6]["type"], "block");
+    ASSERT_EQ(lines[6]["miner_id"], 0);
+    ASSERT_EQ(lines[7]["type"], "summary");
+    input.close();
+    std::remove("results_dictionary.ndjson");
+    std::remove("results_dictionary.ndjson.idx");
+
+    writer = ResultWriter::create("results_dictionary.json", false, BlockField::all, true);
+    writer->write_block(block_event);
+    writer->finish(12, {}, {});
+    std::ifstream json_input("results_dictionary.json");
+    auto result = nlohmann::json::parse(json_input);
+    ASSERT_EQ(result["blocks"][0]["pool_id"], 0);
+    ASSERT_EQ(result["blocks"][0]["miner_id"], 0);
+    ASSERT_EQ(result["blocks"][0]["reward_scheme_data"]["receiver_id"], 1);
+    ASSERT_EQ(result["dictionary"]["addresses"], R"(["address", "receiver"])"_json);
+    ASSERT_EQ(result["dictionary"]["pool_names"], R"(["pool"])"_json);
+    std::remove("results_dictionary.json");
+    std::remove("results_dictionary.json.idx");
+
+    writer = ResultWriter::create("results_dictionary.psim");
+    writer->write_hop(hop_event);
+    writer->finish(12, {}, {});
+    ColumnarReader reader("results_dictionary.psim");
+    ASSERT_EQ(reader.get_column<uint64_t>("hops.time")[0], 2);
+    ASSERT_EQ(reader.get_string_column("addresses")[reader.get_column<uint32_t>("hops.miner_id")[0]], "address");
+    std::remove("results_dictionary.psim");
+    std::remove("results_dictionary.psim.idx");
+}
+
+TEST(ResultWriter, memory_usage) {
+    BlockMetaData block_data;
+    const std::string pool_name = "pool";
+    BlockEvent block_event {
+        .time = 1,
+        .is_uncle = false,
+        .pool_name = &pool_name,
+        .miner_address = Address("memory_usage_miner"),
+        .reward_scheme_data_type = BlockDataType::basic,
+        .reward_scheme_data = &block_data
+    };
+
+    MemoryUsage usage;
+    auto json_writer = ResultWriter::create("results_memory.json", false, BlockField::all, true);
+    json_writer->write_block(block_event);
+    json_writer->add_memory_usage(usage);
+    ASSERT_GE(usage["output_dictionary"], sizeof(Address) + sizeof(std::string));
+    ASSERT_EQ(usage.count("output_columns"), 0);
+    json_writer->finish(12, {}, {});
+
+    usage.clear();
+    AsyncResultWriter columnar_writer(ResultWriter::create("results_memory.psim"));
+    for (int i = 0; i < 100; i++) {
+        columnar_writer.write_block(block_event);
+    }
+    columnar_writer.add_memory_usage(usage);
+    ASSERT_GE(usage["output_queue"], sizeof(OutputRecord));
+    columnar_writer.finish(12, {}, {});
+    usage.clear();
+    columnar_writer.add_memory_usage(usage);
+    ASSERT_GE(usage["output_columns"], 100 * (sizeof(double) + sizeof(uint32_t)));
+    ASSERT_GE(usage["output_dictionary"], sizeof(Address) + sizeof(std::string));
+
+    for (const char* filepath : {"results_memory.json", "results_memory.json.idx",
+                                 "results_memory.psim", "results_memory.psim.idx"}) {
+        std::remove(filepath);
+    }
+}
+
+TEST(Profiler, nested_scopes) {
+    Profiler& profiler = Profiler::get_instance();
+    profiler.reset();
+    {
+        ProfileScope run_scope(ProfilePhase::run);
+        for (int i = 0; i < 3; i++) {
+            ProfileScope random_scope(ProfilePhase::random);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    const PhaseProfile& run = profiler.get_phase(ProfilePhase::run);
+    const PhaseProfile& random = profiler.get_phase(ProfilePhase::random);
+    ASSERT_EQ(run.calls, 1);
+    ASSERT_EQ(random.calls, 3);
+    ASSERT_EQ(random.self_nanoseconds, random.total_nanoseconds);
+    ASSERT_GE(random.total_nanoseconds, 300000);
+    ASSERT_EQ(run.self_nanoseconds, run.total_nanoseconds - random.total_nanoseconds);
+
+    auto writer = ResultWriter::create("results_profile.ndjson");
+    writer->write_profile(profiler);
+    writer->finish(12, {}, {});
+    std::ifstream input("results_profile.ndjson");
+    auto summary = nlohmann::json::parse(input);
+    ASSERT_EQ(summary["type"], "summary");
+    ASSERT_EQ(summary["profile"]["random"]["calls"], 3);
+    ASSERT_EQ(summary["profile"]["event_pop"]["calls"], 0);
+    std::remove("results_profile.ndjson");
+    std::remove("results_profile.ndjson.idx");
+    profiler.reset();
+}
+
+TEST(ProgressReporter, report) {
+    ProgressReporter reporter("progress.json", 3600);
+    ASSERT_FALSE(reporter.is_due());
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ProgressStatus status {.blocks = 25, .target_blocks = 100, .events = 1000, .shares = 800,
+                           .queue_size = 10, .done = false};
+    auto report = reporter.get_report(status, std::chrono::steady_clock::now());
+    ASSERT_EQ(report["type"], "progress");
+    ASSERT_EQ(report["blocks"], 25);
+    ASSERT_EQ(report["queue_size"], 10);
+    ASSERT_GT(report["rss_bytes"].get<uint64_t>(), 0);
+    ASSERT_GE(report["elapsed_seconds"].get<double>(), 0.01);
+    ASSERT_DOUBLE_EQ(report["eta_seconds"].get<double>(), 3 * report["elapsed_seconds"].get<double>());
+    ASSERT_DOUBLE_EQ(report["average_events_per_second"].get<double>(),
+                     1000 / report["elapsed_seconds"].get<double>());
+    ASSERT_DOUBLE_EQ(report["average_shares_per_second"].get<double>(),
+                     800 / report["elapsed_seconds"].get<double>());
+    ASSERT_LT(report["shares_per_second"].get<double>(), report["events_per_second"].get<double>());
+
+    reporter.report(status);
+    status.events = 1500;
+    status.shares = 1100;
+    status.done = true;
+    reporter.report(status);
+    std::ifstream input("progress.json");
+    auto written = nlohmann::json::parse(input);
+    ASSERT_EQ(written["events"], 1500);
+    ASSERT_EQ(written["shares"], 1100);
+    ASSERT_EQ(written["done"], true);
+    ASSERT_EQ(written["eta_seconds"], 0.0);
+    ASSERT_FALSE(std::ifstream("progress.json.tmp").good());
+    std::remove("progress.json");
+}
+
+TEST(Tracer, spans) {
+    Tracer& tracer = Tracer::get_instance();
+    {
+        TraceSpan span("initialize", "disabled");
+    }
+    ASSERT_TRUE(tracer.get_events().empty());
+
+    tracer.enable(2);
+    tracer.set_thread_name("simulation");
+    {
+        TraceSpan span("initialize", "initialize", {{"pools", 1}});
+        span.set_arg("miners", 3);
+        TraceSampler sampler;
+        for (int i = 0; i < 5; i++) {
+            sampler.tick();
+        }
+    }
+    std::thread other_thread([&tracer] {
+        tracer.set_thread_name("output");
+        TraceSpan span("output", "compress");
+    });
+    other_thread.join();
+
+    const std::vector<TraceEvent>& events = tracer.get_events();
+    ASSERT_EQ(events.size(), 5);
+    ASSERT_EQ(events[0].name, "events");
+    ASSERT_EQ(events[0].args["events"], 2);
+    ASSERT_EQ(events[2].args["events"], 1);
+    ASSERT_EQ(events[3].name, "initialize");
+    ASSERT_EQ(events[3].args["miners"], 3);
+    ASSERT_LE(events[3].start_microseconds, events[0].start_microseconds);
+    ASSERT_NE(events[4].thread_id, events[3].thread_id);
+
+    tracer.write("trace.json");
+    std::ifstream input("trace.json");
+    auto trace = nlohmann::json::parse(input);
+    ASSERT_EQ(trace["traceEvents"].size(), 7);
+    ASSERT_EQ(trace["traceEvents"][0]["ph"], "M");
+    ASSERT_EQ(trace["traceEvents"][0]["args"]["name"], "simulation");
+    ASSERT_EQ(trace["traceEvents"][5]["ph"], "X");
+    ASSERT_EQ(trace["traceEvents"][5]["cat"], "initialize");
+    std::remove("trace.json");
+    tracer.reset();
+}
+
+TEST(PerfCounters, counts_or_degrades) {
+    PerfCounters perf_counters;
+    perf_counters.start();
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < 1000000; i++) {
+        sum += i;
+    }
+    perf_counters.stop();
+    PerfCounts counts = perf_counters.read();
+    if (counts.is_available(PerfEvent::instructions)) {
+        ASSERT_GE(counts.get(PerfEvent::instructions), 1000000);
+    }
+    if (!perf_counters.is_available()) {
+        for (size_t i = 0; i < perf_events_count; i++) {
+            ASSERT_FALSE(counts.is_available(static_cast<PerfEvent>(i)));
+        }
+    }
+
+    nlohmann::json j = counts;
+    ASSERT_TRUE(j.find("ipc") != j.end());
+    ASSERT_EQ(j["cycles"].is_null(), !counts.is_available(PerfEvent::cycles));
+
+    auto writer = ResultWriter::create("results_perf_counters.ndjson");
+    writer->write_perf_counters(counts);
+    writer->write_peak_rss(get_peak_rss_bytes());
+    writer->finish(12, {}, {});
+    std::ifstream input("results_perf_counters.ndjson");
+    auto summary = nlohmann::json::parse(input);
+    ASSERT_EQ(summary["perf_counters"], j);
+    ASSERT_GT(summary["peak_rss_bytes"].get<uint64_t>(), 0);
+    std::remove("results_perf_counters.ndjson");
+    std::remove("results_perf_counters.ndjson.idx");
+}
+
+TEST(AllocationTracker, attribution) {
+    Profiler::get_instance().reset();
+    AllocationTracker& tracker = AllocationTracker::get_instance();
+    tracker.start();
+    tracker.record_allocation(8);
+    {
+        ProfileScope run_scope(ProfilePhase::run);
+        tracker.set_stage(SimulationStage::run);
+        tracker.record_allocation(16);
+        ProfileScope random_scope(ProfilePhase::random);
+        tracker.record_allocation(32);
+    }
+    tracker.set_stage(SimulationStage::save);
+    std::thread other_thread([&tracker] { tracker.record_allocation(64); });
+    other_thread.join();
+
+    ASSERT_EQ(tracker.get_total().count, 3);
+    ASSERT_EQ(tracker.get_total().bytes, 56);
+    ASSERT_EQ(tracker.get_stage(SimulationStage::initialize).bytes, 8);
+    ASSERT_EQ(tracker.get_stage(SimulationStage::run).count, 2);
+    ASSERT_EQ(tracker.get_stage(SimulationStage::save).count, 0);
+    ASSERT_EQ(tracker.get_phase(ProfilePhase::run).bytes, 16);
+    ASSERT_EQ(tracker.get_phase(ProfilePhase::random).bytes, 32);
+    ASSERT_EQ(tracker.get_unprofiled().bytes, 8);
+    ASSERT_EQ(tracker.get_other_threads().bytes, 64);
+
+    auto report = get_allocation_report(tracker, 4);
+    ASSERT_EQ(report["stages"]["run"]["count"], 2);
+    ASSERT_EQ(report["phases"]["none"]["count"], 1);
+    ASSERT_DOUBLE_EQ(report["allocations_per_share"].get<double>(), 0.5);
+    ASSERT_DOUBLE_EQ(report["bytes_per_share"].get<double>(), 12.0);
+    ASSERT_TRUE(get_allocation_report(tracker, 0)["allocations_per_share"].is_null());
+    Profiler::get_instance().reset();
+}
+
+TEST(ResultWriter, json) {
+    auto writer = ResultWriter::create("results_writer.json");
+    BlockMetaData block_data;
+    QBBlockMetaData qb_block_data;
+    const std::string pool_name = "pool";
+    BlockEvent block_event {
+        .time = 1,
+        .is_uncle = false,
+        .pool_name = &pool_name,
+        .miner_address = Address("address"),
+        .reward_scheme_data_type = BlockDataType::basic,
+        .reward_scheme_data = &block_data
+    };
+    block_data.shares_per_block = 3;
+    writer->write_block(block_event);
+    qb_block_data.shares_per_block = 5;
+    block_event.reward_scheme_data_type = BlockDataType::qb;
+    block_event.reward_scheme_data = &qb_block_data;
+    writer->write_block(block_event);
+    // the writer must have copied the data
+    block_data.shares_per_block = 0;
+    qb_block_data.shares_per_block = 0;
+    writer->finish(12, {}, {});
+
+    std::ifstream input("results_writer.json");
+    auto result = nlohmann::json::parse(input);
+    ASSERT_EQ(result["blocks"].size(), 2);
+    ASSERT_EQ(result["blocks"][0]["reward_scheme_data"]["shares_per_block"], 3);
+    ASSERT_EQ(result["blocks"][1]["reward_scheme_data"]["shares_per_block"], 5);
+    ASSERT_EQ(result["blocks"][1]["reward_scheme_data"].count("receiver_address"), 1);
+    ASSERT_EQ(result["runtime_milliseconds"], 12);
+    std::remove("results_writer.json");
+    std::remove("results_writer.json.idx");
+}
+
+TEST(ResultWriter, columnar) {
+    auto network = get_sample_network();
+    auto pool = MiningPool::create("pool", 10, 0, RewardSchemeFactory::create("pps", nlohmann::json::object()), network);
+    auto miner = Miner::create("miner_address", 25, create_share_handler("default", nlohmann::json::object()), network);
+    miner->join_pool(pool);
+    miner->process_share(Share(Share::Property::none));
+
+    auto writer = ResultWriter::create("results.psim");
+    QBBlockMetaData block_data;
+    block_data.shares_per_block = 7;
+    block_data.receiver_address = Address("receiver_address");
+    const std::string pool_name = "pool";
+    BlockEvent block_event {
+        .time = 1.5,
+        .is_uncle = true,
+        .pool_name = &pool_name,
+        .miner_address = Address("miner_address"),
+        .reward_scheme_data_type = BlockDataType::qb,
+        .reward_scheme_data = &block_data
+    };
+    writer->write_block(block_event);
+    writer->finish(12, std::vector<std::shared_ptr<MiningPool>>{pool}, std::vector<std::shared_ptr<Miner>>{miner});
+
+    ColumnarReader reader("results.psim");
+    ASSERT_EQ(reader.get_column<uint64_t>("runtime_milliseconds")[0], 12);
+    auto addresses = reader.get_string_column("addresses");
+    auto times = reader.get_column<double>("blocks.time");
+    ASSERT_EQ(times.size(), 1);
+    ASSERT_EQ(times[0], 1.5);
+    ASSERT_EQ(reader.get_column<uint8_t>("blocks.is_uncle")[0], 1);
+    ASSERT_EQ(reader.get_column<uint32_t>("blocks.pool_id")[0], 0);
+    ASSERT_EQ(addresses[reader.get_column<uint32_t>("blocks.miner_id")[0]], "miner_address");
+    ASSERT_EQ(addresses[reader.get_column<uint32_t>("blocks.receiver_id")[0]], "receiver_address");
+    ASSERT_EQ(reader.get_column<uint64_t>("blocks.shares_per_block")[0], 7);
+    ASSERT_EQ(reader.get_string_column("pools.name")[0], "pool");
+    ASSERT_EQ(reader.get_column<uint64_t>("pools.difficulty")[0], 10);
+    ASSERT_EQ(addresses[reader.get_column<uint32_t>("pool_miners.address_id")[0]], "miner_address");
+    ASSERT_EQ(reader.get_column<uint64_t>("pool_miners.share_count")[0], 1);
+    ASSERT_EQ(reader.get_string_column("miners.behavior")[0], "default");
+    ASSERT_EQ(reader.get_column<uint64_t>("miners.total_work")[0], 10);
+    ASSERT_EQ(reader.get_column<double>("miners.hashrate")[0], 25);
+    ASSERT_THROW(reader.get_column<double>("blocks.pool_id"), ColumnarFormatException);
+    ASSERT_THROW(reader.get_column<double>("unknown"), ColumnarFormatException);
+    std::remove("results.psim");
+    std::remove("results.psim.idx");
+}
+
+TEST(ResultIndex, query_miner_info) {
+    auto network = get_sample_network();
+    auto pool = MiningPool::create("pool", 10, 0, RewardSchemeFactory::create("pps", nlohmann::json::object()), network);
+    std::vector<std::shared_ptr<Miner>> miners;
+    for (int i = 0; i < 3; i++) {
+        auto miner = Miner::create("miner_" + std::to_string(i), 25, create_share_handler("default", nlohmann::json::object()), network);
+        miner->join_pool(pool);
+        for (int j = 0; j <= i; j++) {
+            miner->process_share(Share(Share::Property::none));
+        }
+        miner->process_share(Share(Share::Property::valid_block));
+        miners.push_back(miner);
+    }
+
+    for (std::string filepath : {"results_index.json", "results_index.ndjson", "results_index.psim"}) {
+        auto writer = ResultWriter::create(filepath);
+        writer->finish(12, std::vector<std::shared_ptr<MiningPool>>{pool}, miners);
+
+        MinerInfo info = query_miner_info(filepath, "miner_1");
+        ASSERT_EQ(info.blocks_mined, 1);
+        ASSERT_EQ(info.work_per_block_solo, 30);
+        ASSERT_EQ(info.work_in_pool_per_block.size(), 1);
+        ASSERT_EQ(info.work_in_pool_per_block.count("pool"), 1);
+        nlohmann::json j = info;
+        ASSERT_EQ(j["blocks_mined"], 1);
+        ASSERT_THROW(query_miner_info(filepath, "unknown"), std::invalid_argument);
+
+        std::remove(filepath.c_str());
+        std::remove(get_index_filepath(filepath).c_str());
+    }
+}
+
 TEST(Random, UniformDistribution) {
     auto args = R"({"low": 0.0, "high": 10.0})"_json;
     auto dist = DistributionFactory::create("uniform", args);